@@ -2,15 +2,18 @@
 #include "reportdatamodel.h"
 #include "DataBindingConfig.h"
 #include "TaosDataFetcher.h"
+#include "RtuDictionary.h"
 
 #include <qDebug>
 #include <QDate>
 #include <QTime>
 #include <stdexcept>
+#include <algorithm>
 #include <QProgressDialog>
 #include <QtConcurrent>
 #include <QEventLoop>
 #include <QTimer>
+#include <QThread>
 
 BaseReportParser::BaseReportParser(ReportDataModel* model, QObject* parent)
     : QObject(parent)
@@ -20,6 +23,7 @@ BaseReportParser::BaseReportParser(ReportDataModel* model, QObject* parent)
     , m_taskWatcher(nullptr) 
     , m_isTaskRunning(false) 
     , m_cancelRequested(0)  
+    , m_hasPendingTask(false)
     , m_lastPrefetchSuccessCount(0)  
     , m_lastPrefetchTotalCount(0)
     , m_cacheTimestamp()
@@ -47,19 +51,32 @@ BaseReportParser::~BaseReportParser()
 
 void BaseReportParser::startAsyncTask()
 {
+    // 计划在 GUI 线程上生成，工作线程只持有不可变的副本，不再读取模型和任务列表
+    PrefetchPlanPtr plan = buildPrefetchPlan();
+
     if (m_isTaskRunning) {
-        qWarning() << "任务已在进行中，无法重复启动。";
+        // 旧计划已过时：中止它，完成后立即以新计划重新启动
+        qDebug() << "任务进行中，取消旧任务并排队新的预查询计划";
+        m_pendingPlan = plan;
+        m_hasPendingTask = true;
+        m_cancelRequested.storeRelease(1);
         return;
     }
 
+    launchAsyncTask(plan);
+}
+
+void BaseReportParser::launchAsyncTask(const PrefetchPlanPtr& plan)
+{
     m_isTaskRunning = true;
     m_cancelRequested.storeRelease(0);
+    m_plannedDirtyCells = m_model ? m_model->dirtyCells() : QSet<QPoint>();
 
     // 使用 QtConcurrent::run 启动后台任务
-    m_taskFuture = QtConcurrent::run([this]() -> bool {
+    m_taskFuture = QtConcurrent::run([this, plan]() -> bool {
         try {
             // runAsyncTask 是一个虚函数，由子类实现具体任务
-            return this->runAsyncTask();
+            return this->runAsyncTask(plan);
         }
         catch (const std::exception& e) {
             qWarning() << "[后台线程] 发生未捕获的异常：" << e.what();
@@ -75,6 +92,16 @@ void BaseReportParser::startAsyncTask()
 void BaseReportParser::onAsyncTaskFinished()
 {
     m_isTaskRunning = false;
+
+    if (m_hasPendingTask) {
+        // 被新计划取代的任务不发射完成信号，等待者只关心最新计划的结果
+        PrefetchPlanPtr plan = m_pendingPlan;
+        m_pendingPlan.reset();
+        m_hasPendingTask = false;
+        launchAsyncTask(plan);
+        return;
+    }
+
     bool success = m_taskFuture.result();
 
     QString message;
@@ -85,13 +112,15 @@ void BaseReportParser::onAsyncTaskFinished()
     else if (success) {
         message = "后台任务成功完成。";
         if (m_model) {
-            m_model->markAllCellsClean();
-            qDebug() << "预查询完成，已标记所有单元格为干净";
+            // 预查询期间用户可能继续编辑，只清除计划生成时已纳入的脏标记
+            m_model->markCellsClean(m_plannedDirtyCells);
+            qDebug() << "预查询完成，已标记计划内单元格为干净";
         }
     }
     else {
         message = "后台任务执行失败。";
     }
+    m_plannedDirtyCells.clear();
 
     // 发射统一的完成信号
     emit asyncTaskCompleted(success, message);
@@ -100,6 +129,8 @@ void BaseReportParser::onAsyncTaskFinished()
 void BaseReportParser::requestCancel()
 {
     if (m_isTaskRunning) {
+        m_pendingPlan.reset();
+        m_hasPendingTask = false;
         m_cancelRequested.storeRelease(1);
     }
 }
@@ -107,65 +138,202 @@ void BaseReportParser::requestCancel()
 void BaseReportParser::clearCache()
 {
     QMutexLocker locker(&m_cacheMutex);
-    qDebug() << "清空缓存：" << m_dataCache.size() << "个数据点";
-    m_dataCache.clear();
-    m_rtuidIndexCache.clear();  // 新增
+    int pointCount = 0;
+    for (const SeriesIndex& series : m_seriesCache) {
+        pointCount += series.size();
+    }
+    qDebug() << "清空缓存：" << pointCount << "个数据点";
+    m_seriesCache.clear();
     m_cacheTimestamp = QDateTime();
 }
 
-bool BaseReportParser::findInCache(const QString& rtuId, int64_t timestamp, float& value)
+bool BaseReportParser::findInCache(int rtuKey, int64_t timestamp, float& value)
 {
     QMutexLocker locker(&m_cacheMutex);
 
-    CacheKey key;
-    key.rtuId = rtuId;
-    key.timestamp = timestamp;
+    if (rtuKey < 0 || rtuKey >= m_seriesCache.size()) {
+        return false;
+    }
 
-    // 1. 精确匹配
-    if (m_dataCache.contains(key)) {
-        value = m_dataCache[key];
-        return true;
+    // 精确匹配与容错匹配统一走二分查找
+    const int64_t tolerance = 300000;
+    return m_seriesCache.at(rtuKey).findNearest(timestamp, tolerance, value);
+}
+
+bool BaseReportParser::fillTasksFromCache(QProgressDialog* progress, int& successCount, int& failCount)
+{
+    successCount = 0;
+    failCount = 0;
+
+    const int total = m_queryTasks.size();
+    if (progress) {
+        progress->setRange(0, total);
+        progress->setLabelText("正在填充数据...");
     }
 
-    // 2. 容错匹配：使用索引加速
+    // 整批写入数据单元格，模型的区域聚合索引在下次公式计算时重建
+    m_model->invalidateAggregateIndex();
+
+    // 任务的 RTU 编号和时间戳均在解析时确定，这里只做查表
     const int64_t tolerance = 300000;
+    const int progressStep = 256;
+
+    for (int begin = 0; begin < total; begin += progressStep) {
+        if (progress && progress->wasCanceled()) {
+            for (int j = begin; j < total; ++j) {
+                m_queryTasks[j].cell->queryExecuted = false;
+            }
+            qDebug() << "用户取消填充";
+            return false;
+        }
+
+        const int end = qMin(begin + progressStep, total);
+        {
+            QMutexLocker locker(&m_cacheMutex);
+            for (int i = begin; i < end; ++i) {
+                const QueryTask& task = m_queryTasks.at(i);
+                float value = 0.0f;
+                bool hit = task.timestampMs >= 0 &&
+                    task.rtuKey >= 0 && task.rtuKey < m_seriesCache.size() &&
+                    m_seriesCache.at(task.rtuKey).findNearest(task.timestampMs, tolerance, value);
+
+                task.cell->setValue(hit ? CellValue::fromNumber(value) : CellValue::notAvailable());
+                task.cell->queryExecuted = true;
+                task.cell->querySuccess = hit;
+                if (hit) {
+                    successCount++;
+                }
+                else {
+                    failCount++;
+                }
+            }
+        }
+
+        if (progress) {
+            progress->setValue(end);
+        }
+    }
+
+    return true;
+}
+
+void BaseReportParser::resolveTaskTimestamps(const QSet<int>& rows)
+{
+    for (QueryTask& task : m_queryTasks) {
+        if (rows.isEmpty() || rows.contains(task.row)) {
+            task.timestampMs = resolveTaskTimestamp(task);
+        }
+    }
+}
+
+// ===== SeriesIndex 实现 =====
+
+void BaseReportParser::SeriesIndex::mergeSorted(const std::vector<int64_t>& newTimestamps,
+    const std::vector<float>& newValues)
+{
+    const size_t count = qMin(newTimestamps.size(), newValues.size());
+    if (count == 0) {
+        return;
+    }
+
+    // 常见情况：新数据整体位于已有数据之后，直接追加
+    if (timestamps.empty() || newTimestamps.front() > timestamps.back()) {
+        timestamps.insert(timestamps.end(), newTimestamps.begin(), newTimestamps.begin() + count);
+        values.insert(values.end(), newValues.begin(), newValues.begin() + count);
+        return;
+    }
+
+    // 一般情况：归并两个升序序列，重复时间戳以新值覆盖
+    std::vector<int64_t> mergedTs;
+    std::vector<float> mergedValues;
+    mergedTs.reserve(timestamps.size() + count);
+    mergedValues.reserve(timestamps.size() + count);
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < timestamps.size() || j < count) {
+        if (j >= count || (i < timestamps.size() && timestamps[i] < newTimestamps[j])) {
+            mergedTs.push_back(timestamps[i]);
+            mergedValues.push_back(values[i]);
+            ++i;
+        }
+        else {
+            if (i < timestamps.size() && timestamps[i] == newTimestamps[j]) {
+                ++i;  // 旧值被新值覆盖
+            }
+            mergedTs.push_back(newTimestamps[j]);
+            mergedValues.push_back(newValues[j]);
+            ++j;
+        }
+    }
 
-    if (!m_rtuidIndexCache.contains(rtuId)) {
+    timestamps.swap(mergedTs);
+    values.swap(mergedValues);
+}
+
+bool BaseReportParser::SeriesIndex::findNearest(int64_t timestamp, int64_t tolerance, float& value) const
+{
+    if (timestamps.empty()) {
         return false;
     }
 
-    const QList<QPair<int64_t, float>>& timeValues = m_rtuidIndexCache[rtuId];
+    auto it = std::lower_bound(timestamps.begin(), timestamps.end(), timestamp);
+    size_t upper = static_cast<size_t>(it - timestamps.begin());
 
-    int64_t closestDiff = std::numeric_limits<int64_t>::max();
+    // 精确匹配
+    if (upper < timestamps.size() && timestamps[upper] == timestamp) {
+        value = values[upper];
+        return true;
+    }
+
+    // 比较左右两个相邻点，等距时取较早的点
     bool found = false;
-    float closestValue = 0.0f;
-    int64_t closestTimestamp = 0;
+    int64_t closestDiff = tolerance;
+    size_t closestIndex = 0;
 
-    for (const auto& pair : timeValues) {
-        int64_t diff = qAbs(pair.first - timestamp);
-        if (diff <= tolerance && diff < closestDiff) {
+    if (upper > 0) {
+        int64_t diff = timestamp - timestamps[upper - 1];
+        if (diff <= closestDiff) {
             closestDiff = diff;
-            closestValue = pair.second;
-            closestTimestamp = pair.first;
+            closestIndex = upper - 1;
+            found = true;
+        }
+    }
+    if (upper < timestamps.size()) {
+        int64_t diff = timestamps[upper] - timestamp;
+        if (diff <= tolerance && (!found || diff < closestDiff)) {
+            closestIndex = upper;
             found = true;
         }
     }
 
     if (found) {
-        value = closestValue;
-        return true;
+        value = values[closestIndex];
     }
+    return found;
+}
 
-    return false;
+bool BaseReportParser::SeriesIndex::remove(int64_t timestamp)
+{
+    auto it = std::lower_bound(timestamps.begin(), timestamps.end(), timestamp);
+    if (it == timestamps.end() || *it != timestamp) {
+        return false;
+    }
+
+    size_t index = static_cast<size_t>(it - timestamps.begin());
+    timestamps.erase(it);
+    values.erase(values.begin() + index);
+    return true;
 }
 
-bool BaseReportParser::executeSingleQuery(const QString& rtuList,
+QString BaseReportParser::buildBlockQuery(const QVector<int>& rtuKeys,
     const QTime& startTime,
     const QTime& endTime,
     int intervalSeconds)
 {
     QString query;
     QString startDateStr, endDateStr;
+    QString rtuList = RtuDictionary::instance().joinNames(rtuKeys);
 
     if (getDateRange(startDateStr, endDateStr)) {
         // 月报模式
@@ -187,60 +355,70 @@ bool BaseReportParser::executeSingleQuery(const QString& rtuList,
             .arg(intervalSeconds);
     }
 
-    auto startQueryTime = QDateTime::currentDateTime();  
+    return query;
+}
 
-    try {
-        auto dataMap = m_fetcher->fetchDataFromAddress(query.toStdString());
-
-        if (!dataMap.empty()) {
-            // 只打印前3个时间戳
-            int count = 0;
-            for (auto it = dataMap.begin(); it != dataMap.end() && count < 3; ++it, ++count) {
-                int64_t ts = it->first;
-                QDateTime dt = QDateTime::fromMSecsSinceEpoch(ts);
-            }
-        }
+bool BaseReportParser::executeSingleQuery(const QVector<int>& rtuKeys,
+    const QTime& startTime,
+    const QTime& endTime,
+    int intervalSeconds)
+{
+    QString query = buildBlockQuery(rtuKeys, startTime, endTime, intervalSeconds);
 
-        for (auto it = dataMap.begin(); it != dataMap.end(); ++it) {
-            int64_t ts = it->first;
-            QDateTime dt = QDateTime::fromMSecsSinceEpoch(ts);
+    try {
+        // 【优化】流式读取：每段数据到达即合并入缓存，峰值内存与分段大小成正比
+        size_t totalRows = 0;
+        bool completed = m_fetcher->fetchStreaming(query.toStdString(),
+            [this, &rtuKeys, &totalRows](const TaosColumnarData& chunk) {
+                mergeIntoCache(rtuKeys, chunk);
+                totalRows += chunk.rowCount();
+
+                // 取消请求在分段之间生效，中止剩余传输
+                return !m_cancelRequested.loadAcquire();
+            });
+
+        if (!completed) {
+            qDebug() << "  查询被中断，已缓存" << totalRows << "行";
+            return false;
         }
 
-        if (dataMap.empty()) {
+        if (totalRows == 0) {
             qWarning() << "  查询无数据";
             emit databaseError("未获取到有效数据，请检查TDengine连接");
             return false;
         }
 
-        // 【优化】在锁外准备数据
-        QHash<CacheKey, float> tempCache;
-        QHash<QString, QList<QPair<int64_t, float>>> tempIndexCache;
-        QStringList rtuArray = rtuList.split(",");
-
-        for (auto it = dataMap.begin(); it != dataMap.end(); ++it) {
-            int64_t timestamp = it->first;
-            const std::vector<float>& values = it->second;
+        return true;
+    }
+    catch (const std::exception& e) {
+        qWarning() << "  查询失败：" << e.what();
+        emit databaseError(QString("数据查询失败: %1").arg(e.what()));
+        return false;
+    }
+}
 
-            for (int i = 0; i < rtuArray.size() && i < values.size(); ++i) {
-                CacheKey key;
-                key.rtuId = rtuArray[i];
-                key.timestamp = timestamp;
-                tempCache[key] = values[i];
+bool BaseReportParser::fetchBlock(const QString& query, TaosColumnarData& data, double* readElapsedMs)
+{
+    if (readElapsedMs) {
+        *readElapsedMs = 0.0;
+    }
 
-                tempIndexCache[rtuArray[i]].append(qMakePair(timestamp, values[i]));
-            }
+    try {
+        bool completed = m_fetcher->fetchStreaming(query.toStdString(),
+            [this, &data](const TaosColumnarData& chunk) {
+                data.append(chunk);
+                return !m_cancelRequested.loadAcquire();
+            }, readElapsedMs);
+
+        if (!completed) {
+            qDebug() << "  查询被中断";
+            return false;
         }
 
-        // 【优化】快速持锁写入
-        {
-            QMutexLocker locker(&m_cacheMutex);
-            m_dataCache.unite(tempCache);
-
-            for (auto it = tempIndexCache.constBegin(); it != tempIndexCache.constEnd(); ++it) {
-                m_rtuidIndexCache[it.key()].append(it.value());
-            }
-
-            m_cacheTimestamp = QDateTime::currentDateTime();
+        if (data.empty()) {
+            qWarning() << "  查询无数据";
+            emit databaseError("未获取到有效数据，请检查TDengine连接");
+            return false;
         }
 
         return true;
@@ -252,6 +430,23 @@ bool BaseReportParser::executeSingleQuery(const QString& rtuList,
     }
 }
 
+void BaseReportParser::mergeIntoCache(const QVector<int>& rtuKeys, const TaosColumnarData& data)
+{
+    QMutexLocker locker(&m_cacheMutex);
+
+    const int rtuCount = qMin(rtuKeys.size(), (int)data.columnCount());
+    for (int i = 0; i < rtuCount; ++i) {
+        int rtuKey = rtuKeys[i];
+        if (rtuKey < 0) continue;
+        if (rtuKey >= m_seriesCache.size()) {
+            m_seriesCache.resize(rtuKey + 1);
+        }
+        m_seriesCache[rtuKey].mergeSorted(data.timestamps, data.columns[i]);
+    }
+
+    m_cacheTimestamp = QDateTime::currentDateTime();
+}
+
 // 虚函数：获取日期范围（月报重写）
 bool BaseReportParser::getDateRange(QString& startDate, QString& endDate)
 {
@@ -261,28 +456,66 @@ bool BaseReportParser::getDateRange(QString& startDate, QString& endDate)
     return false;
 }
 
-bool BaseReportParser::shouldMergeBlocks(const TimeBlock& block1, const TimeBlock& block2)
-{
-    // 计算两个块之间的间隔
-    int gapMinutes = block1.endTime.secsTo(block2.startTime) / 60;
 
-    // 经验阈值：间隔超过2小时（120分钟），就不合并
-    const int MERGE_THRESHOLD_MINUTES = 2 * 60;
+// ===== 行内时间标记索引 =====
 
-    bool shouldMerge = gapMinutes < MERGE_THRESHOLD_MINUTES;
+void BaseReportParser::indexTimeMarker(int row, int col, const QString& value)
+{
+    QVector<RowTimeMarker>& markers = m_rowTimeMarkers[row];
+    auto it = std::lower_bound(markers.begin(), markers.end(), col,
+        [](const RowTimeMarker& marker, int c) { return marker.col < c; });
 
-    if (shouldMerge) {
-        qDebug() << QString("  → 间隔%1分钟 < %2分钟，合并")
-            .arg(gapMinutes).arg(MERGE_THRESHOLD_MINUTES);
+    if (it != markers.end() && it->col == col) {
+        it->value = value;
     }
     else {
-        qDebug() << QString("  → 间隔%1分钟 >= %2分钟，不合并")
-            .arg(gapMinutes).arg(MERGE_THRESHOLD_MINUTES);
+        markers.insert(it, { col, value });
     }
+}
 
-    return shouldMerge;
+void BaseReportParser::unindexTimeMarker(int row, int col)
+{
+    auto rowIt = m_rowTimeMarkers.find(row);
+    if (rowIt == m_rowTimeMarkers.end()) {
+        return;
+    }
+
+    QVector<RowTimeMarker>& markers = rowIt.value();
+    auto it = std::lower_bound(markers.begin(), markers.end(), col,
+        [](const RowTimeMarker& marker, int c) { return marker.col < c; });
+
+    if (it != markers.end() && it->col == col) {
+        markers.erase(it);
+        if (markers.isEmpty()) {
+            m_rowTimeMarkers.erase(rowIt);
+        }
+    }
+}
+
+void BaseReportParser::clearTimeMarkerIndex()
+{
+    m_rowTimeMarkers.clear();
 }
 
+bool BaseReportParser::lookupTimeMarker(int row, int col, QString& value) const
+{
+    auto rowIt = m_rowTimeMarkers.constFind(row);
+    if (rowIt == m_rowTimeMarkers.constEnd()) {
+        return false;
+    }
+
+    // 第一个列号 >= col 的位置之前即为左侧最近的时间标记
+    const QVector<RowTimeMarker>& markers = rowIt.value();
+    auto it = std::lower_bound(markers.constBegin(), markers.constEnd(), col,
+        [](const RowTimeMarker& marker, int c) { return marker.col < c; });
+
+    if (it == markers.constBegin()) {
+        return false;
+    }
+
+    value = (it - 1)->value;
+    return true;
+}
 
 // ===== 默认实现（子类可重写） =====
 
@@ -297,12 +530,151 @@ bool BaseReportParser::isDataMarker(const QString& text) const
 }
 
 
-QString BaseReportParser::extractRtuId(const QString& text)
+QString BaseReportParser::extractRtuId(const QString& text) const
 {
     // #d#AIRTU034700019 → "AIRTU034700019"
     return text.mid(3).trimmed();
 }
 
+// ===== 按行分区的并行扫描 =====
+
+QVector<QPair<int, int>> BaseReportParser::partitionRows(int rowCount)
+{
+    QVector<QPair<int, int>> partitions;
+    if (rowCount <= 0) {
+        return partitions;
+    }
+
+    // 每个线程分几个分区以平衡稀疏/密集行的负载；分区过小时线程切换得不偿失
+    const int minRowsPerPartition = 64;
+    const int maxPartitions = qMax(1, QThread::idealThreadCount() * 4);
+    const int partitionCount = qBound(1, rowCount / minRowsPerPartition, maxPartitions);
+    const int rowsPerPartition = (rowCount + partitionCount - 1) / partitionCount;
+
+    for (int begin = 0; begin < rowCount; begin += rowsPerPartition) {
+        partitions.append(qMakePair(begin, qMin(begin + rowsPerPartition, rowCount)));
+    }
+    return partitions;
+}
+
+void BaseReportParser::runPartitions(int partitionCount, const std::function<void(int)>& fn)
+{
+    if (partitionCount <= 1) {
+        if (partitionCount == 1) {
+            fn(0);
+        }
+        return;
+    }
+
+    QVector<int> indices(partitionCount);
+    for (int i = 0; i < partitionCount; ++i) {
+        indices[i] = i;
+    }
+    QtConcurrent::blockingMap(indices, [&fn](int& index) { fn(index); });
+}
+
+BaseReportParser::RowScan BaseReportParser::classifyRow(int row) const
+{
+    RowScan scan;
+    const int totalCols = m_model->columnCount();
+
+    for (int col = 0; col < totalCols; ++col) {
+        const CellData* cell = m_model->getCell(row, col);
+        if (!cell) continue;
+
+        // ===== 使用 scanText() =====
+        QString text = cell->scanText().trimmed();
+        if (text.isEmpty()) continue;
+
+        RowMarker marker;
+        marker.col = col;
+        marker.resolved = false;
+
+        if (isTimeMarker(text)) {
+            marker.kind = RowMarker::TimeMarker;
+            marker.resolved = resolveTimeMarker(text, marker.value);
+        }
+        else if (isDataMarker(text)) {
+            marker.kind = RowMarker::DataMarker;
+            marker.value = extractRtuId(text);
+        }
+        else {
+            continue;
+        }
+
+        marker.text = text;
+        scan.append(marker);
+    }
+
+    return scan;
+}
+
+void BaseReportParser::parseAllRows()
+{
+    const int totalRows = m_model->rowCount();
+    const QVector<QPair<int, int>> partitions = partitionRows(totalRows);
+
+    // 阶段1：各分区并行识别，结果按行号写入互不重叠的槽位
+    QVector<RowScan> scans(totalRows);
+    RowScan* results = scans.data();
+    runPartitions(partitions.size(), [this, &partitions, results](int index) {
+        for (int row = partitions[index].first; row < partitions[index].second; ++row) {
+            results[row] = classifyRow(row);
+        }
+    });
+
+    // 阶段2：按行序串行写回，m_currentTime 跨行传递，与逐行扫描语义一致
+    for (int row = 0; row < totalRows; ++row) {
+        parseRow(row, scans[row]);
+        emit parseProgress(row + 1, totalRows);
+    }
+
+    qDebug() << QString("并行扫描完成：%1 行，%2 个分区").arg(totalRows).arg(partitions.size());
+}
+
+bool BaseReportParser::findFirstCell(const std::function<bool(const QString&)>& predicate,
+    int& foundRow, int& foundCol, QString& foundText) const
+{
+    const int totalCols = m_model->columnCount();
+    const QVector<QPair<int, int>> partitions = partitionRows(m_model->rowCount());
+
+    // 每个分区只记录自身范围内的首个命中，最后取行号最小的分区
+    struct Hit {
+        int row = -1;
+        int col = -1;
+        QString text;
+    };
+    QVector<Hit> hits(partitions.size());
+    Hit* results = hits.data();
+
+    runPartitions(partitions.size(), [&](int index) {
+        for (int row = partitions[index].first; row < partitions[index].second; ++row) {
+            for (int col = 0; col < totalCols; ++col) {
+                const CellData* cell = m_model->getCell(row, col);
+                if (!cell) continue;
+
+                QString text = cell->scanText().trimmed();
+                if (predicate(text)) {
+                    results[index].row = row;
+                    results[index].col = col;
+                    results[index].text = text;
+                    return;
+                }
+            }
+        }
+    });
+
+    for (const Hit& hit : hits) {
+        if (hit.row >= 0) {
+            foundRow = hit.row;
+            foundCol = hit.col;
+            foundText = hit.text;
+            return true;
+        }
+    }
+    return false;
+}
+
 void BaseReportParser::runCorrectnessTest()
 {
     qDebug() << "基类测试函数 - 子类应该重写此方法";
@@ -310,7 +682,7 @@ void BaseReportParser::runCorrectnessTest()
 
 bool BaseReportParser::isCacheValid() const
 {
-    if (m_dataCache.isEmpty()) {
+    if (m_seriesCache.isEmpty()) {
         return false;
     }
 
@@ -441,7 +813,7 @@ BaseReportParser::RescanDiffInfo BaseReportParser::rescanDirtyCells(const QSet<Q
             // 提取并设置 displayValue
             QString timeValue = extractTime(text);
             if (!timeValue.isEmpty()) {
-                cell->displayValue = timeValue;
+                cell->setDisplayText(timeValue);
                 qDebug() << QString("  → 设置后 cellType=%1, markerText='%2', displayValue='%3'")
                     .arg((int)cell->cellType)
                     .arg(cell->markerText)
@@ -463,6 +835,20 @@ BaseReportParser::RescanDiffInfo BaseReportParser::rescanDirtyCells(const QSet<Q
         }
     }
 
+    // ===== 阶段1.8：同步行内时间标记索引 =====
+    for (const auto& pos : cascadedDirtyCells) {
+        CellData* cell = m_model->getCell(pos.x(), pos.y());
+        QString text = cell ? cell->scanText().trimmed() : QString();
+
+        QString value;
+        if (isTimeMarker(text) && resolveTimeMarker(text, value)) {
+            indexTimeMarker(pos.x(), pos.y(), value);
+        }
+        else {
+            unindexTimeMarker(pos.x(), pos.y());
+        }
+    }
+
     qDebug() << "========== 验证新增行的cellType设置 ==========";
     for (const auto& pos : cascadedDirtyCells) {
         int row = pos.x();
@@ -496,6 +882,7 @@ BaseReportParser::RescanDiffInfo BaseReportParser::rescanDirtyCells(const QSet<Q
         // 【处理数据标记】
         if (isDataMarker(text)) {
             QString rtuId = extractRtuId(text);
+            int rtuKey = RtuDictionary::instance().intern(rtuId);
             QString oldMarker = m_scannedMarkers.value(pos);
 
             // ===== 【添加】详细日志 =====
@@ -518,11 +905,16 @@ BaseReportParser::RescanDiffInfo BaseReportParser::rescanDirtyCells(const QSet<Q
                 m_dataMarkerCells.append({ row, col, rtuId });
                 m_scannedMarkers.insert(pos, rtuId);
 
+                cell->rtuId = rtuId;
+                cell->rtuKey = rtuKey;
+
                 QueryTask task;
                 task.cell = cell;
                 task.row = row;
                 task.col = col;
+                task.rtuKey = rtuKey;
                 task.queryPath = timeStr;
+                task.timestampMs = resolveTaskTimestamp(task);
 
                 qDebug() << QString("  → 创建 QueryTask: queryPath='%1'").arg(task.queryPath);
                 m_queryTasks.append(task);
@@ -545,16 +937,15 @@ BaseReportParser::RescanDiffInfo BaseReportParser::rescanDirtyCells(const QSet<Q
                 for (auto& task : m_queryTasks) {
                     if (task.row == row && task.col == col) {
                         QString oldTimeStr = task.queryPath;
-                        if (oldTimeStr != newTimeStr) {
+                        int64_t oldTimestamp = task.timestampMs;
+                        int64_t newTimestamp = resolveTaskTimestamp(task);
+                        if (oldTimestamp != newTimestamp) {
                             // 时间变化，记录到差分
-                            QDateTime oldDateTime = constructDateTime(m_baseDate, oldTimeStr);
-                            QDateTime newDateTime = constructDateTime(m_baseDate, newTimeStr);
-
-                            if (oldDateTime.isValid() && newDateTime.isValid()) {
+                            if (oldTimestamp >= 0 && newTimestamp >= 0) {
                                 RescanDiffInfo::ModifiedMarker modifiedMarker;
-                                modifiedMarker.rtuId = rtuId;
-                                modifiedMarker.oldTimestamp = oldDateTime.toMSecsSinceEpoch();
-                                modifiedMarker.newTimestamp = newDateTime.toMSecsSinceEpoch();
+                                modifiedMarker.rtuKey = rtuKey;
+                                modifiedMarker.oldTimestamp = oldTimestamp;
+                                modifiedMarker.newTimestamp = newTimestamp;
                                 diffInfo.modifiedMarkers.append(modifiedMarker);
 
                                 qDebug() << QString("时间变化：行%1列%2，%3 → %4")
@@ -562,6 +953,7 @@ BaseReportParser::RescanDiffInfo BaseReportParser::rescanDirtyCells(const QSet<Q
                             }
 
                             task.queryPath = newTimeStr;  // 更新时间
+                            task.timestampMs = newTimestamp;
                         }
                         break;
                     }
@@ -573,11 +965,22 @@ BaseReportParser::RescanDiffInfo BaseReportParser::rescanDirtyCells(const QSet<Q
             if (m_scannedMarkers.contains(pos)) {
                 QString oldRtuId = m_scannedMarkers.value(pos);
 
-                // 计算旧时间戳用于缓存清理
-                int64_t oldTimestamp = calculateTimestampForMarker(row, col);
+                // 旧时间戳用于缓存清理（优先取任务解析时确定的时间戳）
+                int64_t oldTimestamp = -1;
+                bool taskFound = false;
+                for (const QueryTask& task : m_queryTasks) {
+                    if (task.row == row && task.col == col) {
+                        oldTimestamp = task.timestampMs;
+                        taskFound = true;
+                        break;
+                    }
+                }
+                if (!taskFound) {
+                    oldTimestamp = calculateTimestampForMarker(row, col);
+                }
                 if (oldTimestamp > 0) {
                     RescanDiffInfo::RemovedMarker removedMarker;
-                    removedMarker.rtuId = oldRtuId;
+                    removedMarker.rtuKey = RtuDictionary::instance().find(oldRtuId);
                     removedMarker.timestamp = oldTimestamp;
                     diffInfo.removedMarkers.append(removedMarker);
                 }
@@ -611,6 +1014,9 @@ BaseReportParser::RescanDiffInfo BaseReportParser::rescanDirtyCells(const QSet<Q
         }
     }
 
+    // 新增或修改的时间标记可能改变同行其余数据标记的时间上下文
+    resolveTaskTimestamps(affectedRows);
+
     qDebug() << QString("增量扫描完成：新增 %1，修改 %2，移除 %3")
         .arg(newCount).arg(modifiedCount).arg(removedCount);
     qDebug() << QString("受影响的行数：%1").arg(affectedRows.size());
@@ -685,59 +1091,27 @@ void BaseReportParser::cleanupCacheByDiff(const RescanDiffInfo& diffInfo)
 
     // 清理被删除的标记
     for (const auto& removed : diffInfo.removedMarkers) {
-        CacheKey key;
-        key.rtuId = removed.rtuId;
-        key.timestamp = removed.timestamp;
-
-        if (m_dataCache.contains(key)) {
-            m_dataCache.remove(key);
+        if (removed.rtuKey >= 0 && removed.rtuKey < m_seriesCache.size() &&
+            m_seriesCache[removed.rtuKey].remove(removed.timestamp)) {
             cleanedCount++;
             qDebug() << QString("  删除缓存：RTU=%1，时间戳=%2")
-                .arg(removed.rtuId).arg(removed.timestamp);
-        }
-
-        // 同时清理索引缓存
-        if (m_rtuidIndexCache.contains(removed.rtuId)) {
-            auto& indexList = m_rtuidIndexCache[removed.rtuId];
-            indexList.erase(
-                std::remove_if(indexList.begin(), indexList.end(),
-                    [&](const QPair<int64_t, float>& pair) {
-                        return pair.first == removed.timestamp;
-                    }),
-                indexList.end()
-            );
+                .arg(RtuDictionary::instance().name(removed.rtuKey)).arg(removed.timestamp);
         }
     }
 
     // 清理时间修改的标记（删除旧时间戳）
     for (const auto& modified : diffInfo.modifiedMarkers) {
-        CacheKey oldKey;
-        oldKey.rtuId = modified.rtuId;
-        oldKey.timestamp = modified.oldTimestamp;
-
-        if (m_dataCache.contains(oldKey)) {
-            m_dataCache.remove(oldKey);
+        if (modified.rtuKey >= 0 && modified.rtuKey < m_seriesCache.size() &&
+            m_seriesCache[modified.rtuKey].remove(modified.oldTimestamp)) {
             cleanedCount++;
             qDebug() << QString("  删除旧缓存：RTU=%1，旧时间戳=%2，新时间戳=%3")
-                .arg(modified.rtuId)
+                .arg(RtuDictionary::instance().name(modified.rtuKey))
                 .arg(modified.oldTimestamp)
                 .arg(modified.newTimestamp);
         }
-
-        // 同时清理索引缓存中的旧时间戳
-        if (m_rtuidIndexCache.contains(modified.rtuId)) {
-            auto& indexList = m_rtuidIndexCache[modified.rtuId];
-            indexList.erase(
-                std::remove_if(indexList.begin(), indexList.end(),
-                    [&](const QPair<int64_t, float>& pair) {
-                        return pair.first == modified.oldTimestamp;
-                    }),
-                indexList.end()
-            );
-        }
     }
 
     qDebug() << QString("缓存清理完成：清理了 %1 个缓存项").arg(cleanedCount);
-    qDebug() << QString("当前缓存大小：%1 项").arg(m_dataCache.size());
+    qDebug() << QString("当前缓存RTU数：%1").arg(m_seriesCache.size());
     qDebug() << "============================================";
 }
\ No newline at end of file
@@ -7,14 +7,22 @@
 #include <QDateTime>
 #include <QList>
 #include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
 #include <QTime>
 #include <QMutex>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QAtomicInt>
+#include <vector>
+#include <memory>
+#include <functional>
 
 class ReportDataModel;
 class TaosDataFetcher;
+struct TaosColumnarData;
 struct CellData;
 class QProgressDialog;
 
@@ -28,19 +36,27 @@ class BaseReportParser : public QObject
 
 public:
     enum EditState {
-        CONFIG_EDIT,      // 配置阶段可编辑
-        PREFETCHING,      // 预查询中（禁止编辑）
+        CONFIG_EDIT,      // 配置阶段可编辑（预查询期间同样可编辑）
         REPORT_READY      // 报表就绪（模板模式不可编辑，统一查询部分可编辑）
     };
 
-    // ===== 缓存键结构（所有报表通用） =====
-    struct CacheKey {
-        QString rtuId;
-        int64_t timestamp;
+    // ===== 单个RTU的时间序列索引（时间戳升序，连续存储） =====
+    struct SeriesIndex {
+        std::vector<int64_t> timestamps;   // 升序时间戳（毫秒）
+        std::vector<float> values;         // 与 timestamps 一一对应
 
-        bool operator==(const CacheKey& other) const {
-            return rtuId == other.rtuId && timestamp == other.timestamp;
-        }
+        bool isEmpty() const { return timestamps.empty(); }
+        int size() const { return static_cast<int>(timestamps.size()); }
+
+        // 合并一批升序数据点，时间戳重复时以新值为准
+        void mergeSorted(const std::vector<int64_t>& newTimestamps,
+            const std::vector<float>& newValues);
+
+        // 二分查找容差范围内最近的数据点（等距时取较早的点）
+        bool findNearest(int64_t timestamp, int64_t tolerance, float& value) const;
+
+        // 删除指定时间戳的数据点
+        bool remove(int64_t timestamp);
     };
 
     // ===== 查询任务结构（所有报表通用） =====
@@ -48,6 +64,8 @@ public:
         CellData* cell;
         int row;
         int col;
+        int rtuKey;         // RTU编号（RtuDictionary），解析时确定
+        int64_t timestampMs;  // 查询时刻（epoch毫秒），解析时确定，-1 表示无法确定
         QString queryPath;  // 可选，某些子类可能不需要
     };
 
@@ -69,6 +87,32 @@ public:
         }
     };
 
+    // ===== 预查询计划（GUI 线程解析后生成，交由工作线程独占只读） =====
+    struct PrefetchPlan {
+        QVector<int> rtuKeys;              // RTU编号（升序），即结果列顺序
+        QStringList rtuNames;              // 与 rtuKeys 一一对应的RTU号
+        int intervalSeconds;               // 查询间隔秒数
+        QStringList blockQueries;          // 日报：按时间块预先构造的查询地址
+        std::vector<int64_t> timestamps;   // 月报：离散查询时刻（epoch毫秒，升序）
+
+        PrefetchPlan() : intervalSeconds(0) {}
+    };
+    typedef std::shared_ptr<const PrefetchPlan> PrefetchPlanPtr;
+
+    // ===== 行扫描结果（并行识别阶段产出，只读取单元格） =====
+    struct RowMarker {
+        enum Kind {
+            TimeMarker,   // #t#
+            DataMarker    // #d#
+        };
+        int col;
+        Kind kind;
+        QString text;      // 标记原文（已去除首尾空白）
+        QString value;     // 时间标记：resolveTimeMarker 的结果；数据标记：RTU号
+        bool resolved;     // 时间标记：resolveTimeMarker 是否成功
+    };
+    typedef QVector<RowMarker> RowScan;
+
     struct DataMarkerInfo {
         int row;           // 行号
         int col;           // 列号
@@ -83,12 +127,12 @@ public:
     // ===== 增量扫描差分信息结构 =====
     struct RescanDiffInfo {
         struct RemovedMarker {
-            QString rtuId;
+            int rtuKey;
             int64_t timestamp;  // 旧的时间戳
         };
 
         struct ModifiedMarker {
-            QString rtuId;
+            int rtuKey;
             int64_t oldTimestamp;  // 旧时间戳
             int64_t newTimestamp;  // 新时间戳
         };
@@ -114,6 +158,7 @@ public:
 
     bool isValid() const { return m_dateFound; }
     int getPendingQueryCount() const { return m_queryTasks.size(); }
+    QList<QueryTask> getQueryTasks() const { return m_queryTasks; }  // 隐式共享快照
 
     bool isAsyncTaskRunning() const { return m_isTaskRunning; }
     void requestCancel();
@@ -134,13 +179,22 @@ public:
 
     RescanDiffInfo rescanDirtyCells(const QSet<QPoint>& dirtyCells);  // 返回差分信息
 
-    bool findInCache(const QString& rtuId, int64_t timestamp, float& value);
+    bool findInCache(int rtuKey, int64_t timestamp, float& value);
+
+    /**
+     * @brief 按任务预先解析的 RTU 编号和时间戳从缓存回填单元格
+     * @param progress 进度对话框（可为空）
+     * @param successCount 输出：命中数量
+     * @param failCount 输出：未命中数量
+     * @return 被用户取消时返回 false
+     */
+    bool fillTasksFromCache(QProgressDialog* progress, int& successCount, int& failCount);
 
     // ===== 缓存管理 =====
     void cleanupCacheByDiff(const RescanDiffInfo& diffInfo);  // 根据差分清理缓存
 
     virtual QString extractTime(const QString& text) const = 0;
-    virtual QString extractRtuId(const QString& text);
+    virtual QString extractRtuId(const QString& text) const;
 
     virtual QVariant formatDisplayValueForMarker(const CellData* cell) const = 0;
 
@@ -190,10 +244,39 @@ protected:
     virtual bool findDateMarker() = 0;
 
     /**
-     * @brief 解析单行数据（识别时间标记和数据标记）
+     * @brief 将单行识别结果写回单元格和任务列表（按行序串行调用，可依赖 m_currentTime）
      * @param row 行号
+     * @param scan classifyRow 的识别结果
+     */
+    virtual void parseRow(int row, const RowScan& scan) = 0;
+
+    /**
+     * @brief 识别单行中的时间标记和数据标记（工作线程调用，只读单元格）
      */
-    virtual void parseRow(int row) = 0;
+    RowScan classifyRow(int row) const;
+
+    /**
+     * @brief 逐行解析整张表：按行分区并行识别，再按行序串行写回
+     * 串行写回保证 m_queryTasks 顺序与逐行扫描完全一致
+     */
+    void parseAllRows();
+
+    /**
+     * @brief 把 [0, rowCount) 切成连续的行分区（行数较少时只有一个分区）
+     */
+    static QVector<QPair<int, int>> partitionRows(int rowCount);
+
+    /**
+     * @brief 并行执行 fn(分区下标)，返回时全部完成
+     */
+    static void runPartitions(int partitionCount, const std::function<void(int)>& fn);
+
+    /**
+     * @brief 按行优先顺序查找首个扫描文本满足条件的单元格（分区并行，结果与串行扫描一致）
+     * @return 是否找到
+     */
+    bool findFirstCell(const std::function<bool(const QString&)>& predicate,
+        int& foundRow, int& foundCol, QString& foundText) const;
 
     /**
      * @brief 从任务中提取时间（不同报表的时间提取方式不同）
@@ -202,6 +285,19 @@ protected:
      */
     virtual QTime getTaskTime(const QueryTask& task) = 0;
 
+    /**
+     * @brief 解析任务对应的查询时刻（不同报表的日期/时间组合规则不同）
+     * @param task 查询任务（行内时间标记索引须已就绪）
+     * @return epoch 毫秒，无法确定时返回 -1
+     */
+    virtual int64_t resolveTaskTimestamp(const QueryTask& task) const = 0;
+
+    /**
+     * @brief 重新计算任务的 timestampMs
+     * @param rows 只处理这些行的任务；为空时处理全部任务
+     */
+    void resolveTaskTimestamps(const QSet<int>& rows = QSet<int>());
+
     /**
      * @brief 构造完整的日期时间（不同报表的组合规则不同）
      * @param date 日期字符串
@@ -216,8 +312,17 @@ protected:
      */
     virtual int getQueryIntervalSeconds() const = 0;
 
-    // 子类需要重写的后台任务函数 
-    virtual bool runAsyncTask() = 0;
+    /**
+     * @brief 在 GUI 线程上根据当前解析结果生成预查询计划
+     * @return 计划对象；不需要预查询的解析器返回空指针
+     */
+    virtual PrefetchPlanPtr buildPrefetchPlan() { return PrefetchPlanPtr(); }
+
+    // 启动工作线程执行指定计划（GUI 线程调用）
+    void launchAsyncTask(const PrefetchPlanPtr& plan);
+
+    // 子类需要重写的后台任务函数（工作线程执行，只能读取 plan，不得访问模型）
+    virtual bool runAsyncTask(const PrefetchPlanPtr& plan) = 0;
 
     // ===== 通用工具函数（子类可直接使用） =====
 
@@ -225,22 +330,45 @@ protected:
 
     /**
      * @brief 执行单次查询
-     * @param rtuList RTU列表（逗号分隔）
+     * @param rtuKeys RTU编号列表
      * @param startTime 起始时间
      * @param endTime 结束时间
      * @param intervalSeconds 间隔秒数
      * @return 是否成功
      */
-    bool executeSingleQuery(const QString& rtuList,
+    bool executeSingleQuery(const QVector<int>& rtuKeys,
+        const QTime& startTime,
+        const QTime& endTime,
+        int intervalSeconds);
+
+    /**
+     * @brief 构造时间块查询地址（RTU1,RTU2@起始~结束#间隔）
+     */
+    QString buildBlockQuery(const QVector<int>& rtuKeys,
         const QTime& startTime,
         const QTime& endTime,
         int intervalSeconds);
 
     /**
-     * @brief 智能分析并预查询
+     * @brief 只读取时间块数据、不写缓存，可在多个工作线程中并发调用
+     * @param query 由 buildBlockQuery 预先构造的查询地址
+     * @param data 输出：按时间升序的列式结果，列顺序与查询地址中的RTU一致
+     * @param readElapsedMs 非空时输出借到连接之后的读取耗时（不含排队等待连接）
+     * @return 是否成功（被取消或无数据返回 false）
+     */
+    bool fetchBlock(const QString& query, TaosColumnarData& data, double* readElapsedMs = nullptr);
+
+    /**
+     * @brief 将读取结果合并入缓存（持锁一次）
+     */
+    void mergeIntoCache(const QVector<int>& rtuKeys, const TaosColumnarData& data);
+
+    /**
+     * @brief 按预查询计划读取数据并写入缓存（工作线程执行）
+     * @param plan 预查询计划
      * @return 是否成功
      */
-    virtual bool analyzeAndPrefetch()= 0;
+    virtual bool analyzeAndPrefetch(const PrefetchPlan& plan) = 0;
 
     /**
      * @brief 识别连续的时间块
@@ -248,14 +376,6 @@ protected:
      */
     virtual QList<TimeBlock> identifyTimeBlocks()=0;
 
-    /**
-     * @brief 判断两个时间块是否应该合并
-     * @param block1 时间块1
-     * @param block2 时间块2
-     * @return 是否应该合并
-     */
-    bool shouldMergeBlocks(const TimeBlock& block1, const TimeBlock& block2);
-
     /**
     * @brief 获取日期范围（月报需要重写）
     * @param startDate 输出：起始日期（如 "2025-07-10"）
@@ -268,6 +388,25 @@ protected:
     virtual bool isTimeMarker(const QString& text) const;
     virtual bool isDataMarker(const QString& text) const;
 
+    /**
+     * @brief 将时间标记文本解析为行内索引值（日报为 HH:mm:ss，月报为日）
+     * @param value 输出：索引值
+     * @return 是否应加入索引（返回 false 的标记在查找时被跳过）
+     */
+    virtual bool resolveTimeMarker(const QString& markerText, QString& value) const = 0;
+
+    // ===== 行内时间标记索引 =====
+    void indexTimeMarker(int row, int col, const QString& value);  // 插入或替换
+    void unindexTimeMarker(int row, int col);
+    void clearTimeMarkerIndex();
+
+    /**
+     * @brief 查找数据标记左侧最近的时间标记（二分查找）
+     * @param value 输出：时间标记索引值
+     * @return 是否找到
+     */
+    bool lookupTimeMarker(int row, int col, QString& value) const;
+
 
 protected slots:
     void onAsyncTaskFinished();
@@ -286,8 +425,7 @@ protected:
     QList<QueryTask> m_queryTasks;     // 待查询任务列表
 
     // 缓存
-    QHash<CacheKey, float> m_dataCache;  // 数据缓存
-    QHash<QString, QList<QPair<int64_t, float>>> m_rtuidIndexCache;
+    QVector<SeriesIndex> m_seriesCache;  // RTU编号 -> 有序时间序列
     QMutex m_cacheMutex;               // 缓存互斥锁
 
     // 预查询
@@ -295,6 +433,9 @@ protected:
     QFutureWatcher<bool>* m_taskWatcher;
     bool m_isTaskRunning;
     QAtomicInt m_cancelRequested;
+    PrefetchPlanPtr m_pendingPlan;     // 运行中再次启动时排队的新计划
+    bool m_hasPendingTask;
+    QSet<QPoint> m_plannedDirtyCells;  // 生成计划时已纳入的脏单元格
 
     int m_lastPrefetchSuccessCount;
     int m_lastPrefetchTotalCount;
@@ -306,14 +447,16 @@ protected:
     // 记录已扫描的绑定信息哈希
     QHash<QPoint, QString> m_scannedMarkers;  // 位置 -> 绑定标记
 
+    // 行内时间标记索引：行 -> 按列升序的时间标记，由 parseRow 建立、rescanDirtyCells 维护
+    struct RowTimeMarker {
+        int col;
+        QString value;
+    };
+    QHash<int, QVector<RowTimeMarker>> m_rowTimeMarkers;
+
 private:
     QDateTime m_cacheTimestamp;                        // 新增
     static const int CACHE_EXPIRE_HOURS = 24;          // 新增
 };
 
-// Hash 函数（用于 QHash）
-inline uint qHash(const BaseReportParser::CacheKey& key, uint seed = 0) {
-    return qHash(key.rtuId, seed) ^ qHash(key.timestamp, seed);
-}
-
 #endif // BASEREPORTPARSER_H
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef CELLVALUE_H
+#define CELLVALUE_H
+
+#include <QString>
+#include <cmath>
+
+/**
+ * @brief 单元格的类型化数值
+ * 查询结果与公式结果按原始 double 保存（不做舍入），N/A 与错误单独标记；
+ * 公式直接读取数值，显示文本（两位小数）由 toDisplayString() 在显示、导出时生成。
+ */
+struct CellValue
+{
+    enum Kind {
+        None,           // 无数值（空单元格或文本）
+        Number,         // 数值
+        NotAvailable,   // N/A（查询无数据或引用了 N/A）
+        Error           // 错误（见 ErrorCode）
+    };
+
+    enum ErrorCode {
+        NoError,
+        SyntaxError,        // #ERROR!
+        CircularReference   // #循环引用!
+    };
+
+    Kind kind;
+    ErrorCode error;
+    double number;
+
+    CellValue() : kind(None), error(NoError), number(0.0) {}
+
+    /**
+     * @brief 数值（非有限值视为 N/A，与统一查询的显示规则一致）
+     */
+    static CellValue fromNumber(double value) {
+        CellValue result;
+        if (std::isfinite(value)) {
+            result.kind = Number;
+            result.number = value;
+        }
+        else {
+            result.kind = NotAvailable;
+        }
+        return result;
+    }
+
+    static CellValue notAvailable() {
+        CellValue result;
+        result.kind = NotAvailable;
+        return result;
+    }
+
+    static CellValue fromError(ErrorCode code) {
+        CellValue result;
+        result.kind = Error;
+        result.error = code;
+        return result;
+    }
+
+    bool isNone() const { return kind == None; }
+    bool isNumber() const { return kind == Number; }
+    bool isNotAvailable() const { return kind == NotAvailable; }
+
+    /**
+     * @brief 显示文本：数值保留两位小数，N/A 与错误显示对应标记
+     */
+    QString toDisplayString() const {
+        switch (kind) {
+        case Number:
+            return QString::number(number, 'f', 2);
+        case NotAvailable:
+            return QString("N/A");
+        case Error:
+            return error == CircularReference ? QString("#循环引用!") : QString("#ERROR!");
+        default:
+            return QString();
+        }
+    }
+};
+
+#endif // CELLVALUE_H
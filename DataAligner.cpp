@@ -0,0 +1,348 @@
+#include "DataAligner.h"
+
+#include <QHash>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+const int64_t DataAligner::kNone = std::numeric_limits<int64_t>::min();
+
+// 单次列处理的总工作量（列数 × 每列点数）低于该值时串行执行，避免线程调度开销
+static const size_t kParallelWorkThreshold = 64 * 1024;
+
+DataAligner::ColumnStats::ColumnStats()
+    : validCount(0)
+    , minValue(std::numeric_limits<double>::quiet_NaN())
+    , maxValue(std::numeric_limits<double>::quiet_NaN())
+    , sum(0.0)
+{
+}
+
+double DataAligner::ColumnStats::average() const
+{
+    return validCount > 0 ? sum / validCount : std::numeric_limits<double>::quiet_NaN();
+}
+
+DataAligner::DataAligner()
+    : m_policy(TimeRangeConfig::AlignNearest)
+    , m_toleranceMs(0)
+    , m_cancelFlag(nullptr)
+    , m_settled(0)
+    , m_matchCount(0)
+    , m_rowCount(0)
+{
+}
+
+void DataAligner::begin(TimeRangeConfig::AlignPolicy policy, std::vector<int64_t> axisMs,
+    int64_t toleranceMs, const QVector<double*>& columns, const QAtomicInt* cancelFlag)
+{
+    m_policy = policy;
+    m_axisMs = std::move(axisMs);
+    m_toleranceMs = toleranceMs;
+    m_columns = columns;
+    m_cancelFlag = cancelFlag;
+    m_settled = 0;
+    m_matchCount = 0;
+    m_rowCount = 0;
+
+    // 同一RTU配置多列时共享结果数组，每个数组只由一个列任务写入
+    QHash<double*, int> firstColumn;
+    m_primary.resize(m_columns.size());
+    m_uniqueColumns.clear();
+    for (int j = 0; j < m_columns.size(); ++j) {
+        auto it = firstColumn.constFind(m_columns[j]);
+        if (it == firstColumn.constEnd()) {
+            firstColumn.insert(m_columns[j], j);
+            m_primary[j] = j;
+            m_uniqueColumns.append(j);
+        }
+        else {
+            m_primary[j] = it.value();
+        }
+    }
+    m_stats.assign(m_columns.size(), ColumnStats());
+
+    const size_t axisSize = m_axisMs.size();
+    m_chosenTs.assign(axisSize, kNone);
+
+    m_nextTs.clear();
+    m_nextValues.clear();
+    if (m_policy == TimeRangeConfig::AlignLinear) {
+        m_nextTs.assign(axisSize, kNone);
+        m_nextValues.assign(m_columns.size(),
+            std::vector<double>(axisSize, std::numeric_limits<double>::quiet_NaN()));
+    }
+}
+
+bool DataAligner::isCanceled() const
+{
+    return m_cancelFlag && m_cancelFlag->loadAcquire();
+}
+
+void DataAligner::forEachColumn(size_t workPerColumn, const std::function<void(int)>& fn) const
+{
+    const int columnCount = m_uniqueColumns.size();
+    if (columnCount < 2 || workPerColumn * columnCount < kParallelWorkThreshold) {
+        for (int j : m_uniqueColumns) {
+            if (isCanceled()) return;
+            fn(j);
+        }
+        return;
+    }
+
+    QVector<int> columns = m_uniqueColumns;
+    QtConcurrent::blockingMap(columns, [this, &fn](int& j) {
+        if (isCanceled()) return;
+        fn(j);
+    });
+}
+
+bool DataAligner::isBetter(size_t i, int64_t candidateTs) const
+{
+    const int64_t current = m_chosenTs[i];
+    if (current == kNone) {
+        return true;
+    }
+
+    switch (m_policy) {
+    case TimeRangeConfig::AlignPrevious:
+    case TimeRangeConfig::AlignLinear:
+        return candidateTs > current;
+    case TimeRangeConfig::AlignNext:
+        return candidateTs < current;
+    case TimeRangeConfig::AlignNearest:
+    default: {
+        // 更近者胜出，距离相同取较早时间戳
+        const int64_t target = m_axisMs[i];
+        const int64_t candidateDiff = std::abs(candidateTs - target);
+        const int64_t currentDiff = std::abs(current - target);
+        return candidateDiff < currentDiff || (candidateDiff == currentDiff && candidateTs < current);
+    }
+    }
+}
+
+void DataAligner::feed(const TaosColumnarData& chunk)
+{
+    m_rowCount += chunk.rowCount();
+    if (chunk.empty() || m_axisMs.empty()) {
+        return;
+    }
+
+    // 只处理落在本段容差范围内的时间轴点
+    const std::vector<int64_t>& timestamps = chunk.timestamps;
+    const size_t rows = timestamps.size();
+    const int64_t tolerance = m_toleranceMs;
+    const size_t first = std::lower_bound(m_axisMs.begin(), m_axisMs.end(),
+        timestamps.front() - tolerance) - m_axisMs.begin();
+    const size_t last = std::upper_bound(m_axisMs.begin() + first, m_axisMs.end(),
+        timestamps.back() + tolerance) - m_axisMs.begin();
+    if (first >= last) {
+        return;
+    }
+
+    const size_t span = last - first;
+    const bool linear = (m_policy == TimeRangeConfig::AlignLinear);
+    m_pick.assign(span, -1);
+    if (linear) {
+        m_pickNext.assign(span, -1);
+    }
+
+    // ===== 双指针归并：时间轴与本段时间戳同时单调前进 =====
+    bool picked = false;
+    size_t r = 0;
+    for (size_t k = 0; k < span; ++k) {
+        const size_t i = first + k;
+        const int64_t target = m_axisMs[i];
+        while (r < rows && timestamps[r] < target) {
+            ++r;
+        }
+
+        // 本段内不晚于目标的最后一行、不早于目标的第一行
+        const bool exact = (r < rows && timestamps[r] == target);
+        const int64_t prevRow = exact ? (int64_t)r : (int64_t)r - 1;
+        const int64_t nextRow = (r < rows) ? (int64_t)r : -1;
+        const bool prevOk = prevRow >= 0 && target - timestamps[prevRow] <= tolerance;
+        const bool nextOk = nextRow >= 0 && timestamps[nextRow] - target <= tolerance;
+
+        int64_t candidate = -1;
+        switch (m_policy) {
+        case TimeRangeConfig::AlignPrevious:
+        case TimeRangeConfig::AlignLinear:
+            candidate = prevOk ? prevRow : -1;
+            break;
+        case TimeRangeConfig::AlignNext:
+            candidate = nextOk ? nextRow : -1;
+            break;
+        case TimeRangeConfig::AlignNearest:
+        default:
+            if (prevOk && (!nextOk || target - timestamps[prevRow] <= timestamps[nextRow] - target)) {
+                candidate = prevRow;
+            }
+            else if (nextOk) {
+                candidate = nextRow;
+            }
+            break;
+        }
+
+        if (candidate >= 0 && isBetter(i, timestamps[candidate])) {
+            m_chosenTs[i] = timestamps[candidate];
+            m_pick[k] = (int32_t)candidate;
+            picked = true;
+        }
+
+        if (linear && nextOk && (m_nextTs[i] == kNone || timestamps[nextRow] < m_nextTs[i])) {
+            m_nextTs[i] = timestamps[nextRow];
+            m_pickNext[k] = (int32_t)nextRow;
+            picked = true;
+        }
+    }
+
+    if (!picked) {
+        return;
+    }
+
+    // ===== 按列连续写入：外层列、内层时间点，目标数组顺序访问 =====
+    const int usableColumns = qMin(m_columns.size(), (int)chunk.columnCount());
+    const int32_t* pick = m_pick.data();
+    const int32_t* pickNext = linear ? m_pickNext.data() : nullptr;
+    forEachColumn(span, [&](int j) {
+        if (j >= usableColumns) return;
+
+        const float* src = chunk.columns[j].data();
+        double* dst = m_columns[j] + first;
+        for (size_t k = 0; k < span; ++k) {
+            const int32_t row = pick[k];
+            if (row >= 0) {
+                dst[k] = src[row];
+            }
+        }
+
+        if (linear) {
+            double* nextDst = m_nextValues[j].data() + first;
+            for (size_t k = 0; k < span; ++k) {
+                const int32_t row = pickNext[k];
+                if (row >= 0) {
+                    nextDst[k] = src[row];
+                }
+            }
+        }
+    });
+}
+
+void DataAligner::scrubNonFinite(double* values, size_t count)
+{
+    // 无分支写法，便于编译器向量化；NaN 保持不变
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < count; ++i) {
+        const double v = values[i];
+        values[i] = (std::fabs(v) == inf) ? nan : v;
+    }
+}
+
+DataAligner::ColumnStats DataAligner::computeStats(const double* values, size_t count)
+{
+    ColumnStats stats;
+    for (size_t i = 0; i < count; ++i) {
+        const double v = values[i];
+        if (std::isnan(v)) continue;
+
+        if (stats.validCount == 0) {
+            stats.minValue = v;
+            stats.maxValue = v;
+        }
+        else {
+            stats.minValue = qMin(stats.minValue, v);
+            stats.maxValue = qMax(stats.maxValue, v);
+        }
+        stats.sum += v;
+        stats.validCount++;
+    }
+    return stats;
+}
+
+int DataAligner::settle(int64_t watermarkMs)
+{
+    // 之后的采样不早于水位线，容差窗口完全落在水位线之前的时间点不会再被更新
+    const size_t upTo = std::lower_bound(m_axisMs.begin() + m_settled, m_axisMs.end(),
+        watermarkMs - m_toleranceMs) - m_axisMs.begin();
+    if (upTo > m_settled && postProcess(m_settled, upTo)) {
+        m_settled = upTo;
+    }
+    return (int)m_settled;
+}
+
+bool DataAligner::finish()
+{
+    const size_t axisSize = m_axisMs.size();
+    const bool linear = (m_policy == TimeRangeConfig::AlignLinear);
+
+    // 尚未定稿的剩余行做后处理，统计覆盖整列
+    if (!postProcess(m_settled, axisSize)) {
+        return false;
+    }
+    m_settled = axisSize;
+
+    forEachColumn(axisSize, [&](int j) {
+        m_stats[j] = computeStats(m_columns[j], axisSize);
+    });
+
+    m_matchCount = 0;
+    for (size_t i = 0; i < axisSize; ++i) {
+        if (m_chosenTs[i] != kNone || (linear && m_nextTs[i] != kNone)) {
+            m_matchCount++;
+        }
+    }
+
+    // 归并缓冲不再需要
+    m_nextValues.clear();
+    std::vector<int32_t>().swap(m_pick);
+    std::vector<int32_t>().swap(m_pickNext);
+
+    return !isCanceled();
+}
+
+bool DataAligner::postProcess(size_t from, size_t to)
+{
+    const size_t count = to - from;
+    const bool linear = (m_policy == TimeRangeConfig::AlignLinear);
+
+    // 插值权重：-1 保持前侧值，1 直接取后侧值，其余按比例插值（各列共用，先串行算好）
+    std::vector<double> weights;
+    if (linear) {
+        weights.assign(count, -1.0);
+        for (size_t k = 0; k < count; ++k) {
+            const size_t i = from + k;
+            const int64_t prevTs = m_chosenTs[i];
+            const int64_t nextTs = m_nextTs[i];
+            if (nextTs == kNone) continue;
+
+            if (prevTs == kNone) {
+                weights[k] = 1.0;
+            }
+            else if (nextTs > prevTs && prevTs != m_axisMs[i]) {
+                weights[k] = double(m_axisMs[i] - prevTs) / double(nextTs - prevTs);
+            }
+        }
+    }
+
+    // ===== 逐列后处理：清理非有限值 → 插值 =====
+    forEachColumn(count, [&](int j) {
+        double* dst = m_columns[j] + from;
+        scrubNonFinite(dst, count);
+
+        if (linear) {
+            double* next = m_nextValues[j].data() + from;
+            scrubNonFinite(next, count);
+            for (size_t k = 0; k < count; ++k) {
+                const double w = weights[k];
+                if (w < 0) continue;
+                dst[k] = (w == 1.0) ? next[k] : dst[k] + (next[k] - dst[k]) * w;
+            }
+        }
+    });
+
+    return !isCanceled();
+}
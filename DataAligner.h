@@ -0,0 +1,118 @@
+#pragma once
+#ifndef DATAALIGNER_H
+#define DATAALIGNER_H
+
+#include "DataBindingConfig.h"
+#include "TaosDataFetcher.h"
+
+#include <QVector>
+#include <QAtomicInt>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief 时间轴对齐器
+ * 将按时间升序到达的查询结果合并到固定时间轴上。每段数据与时间轴做一次双指针归并，
+ * 复杂度为 O(时间轴点数 + 数据行数)；段之间允许重叠、到达顺序任意，结果与分段方式无关。
+ *
+ * 对齐策略：
+ *   - AlignNearest  ：容差内距离最近的采样，距离相同取较早者
+ *   - AlignPrevious ：容差内不晚于时间点的最后一个采样
+ *   - AlignNext     ：容差内不早于时间点的第一个采样
+ *   - AlignLinear   ：前后两侧采样线性插值，只有一侧时取该侧
+ *
+ * 非有限值（inf）在后处理时逐列批量替换为 NaN，归并循环内不做逐值判断。
+ * 数据按时间顺序到达时，可用 settle() 提前对已不会再变化的前缀做后处理，
+ * 使其在查询结束前即可读取；finish() 只处理剩余部分。
+ * 各列互相独立：列数据写入、清理、插值和统计在列数较多时分发到全局线程池，
+ * 每列仍按同一顺序处理，结果与串行执行一致。
+ */
+class DataAligner
+{
+public:
+    // 单列统计（基于对齐后的有效值）
+    struct ColumnStats {
+        int validCount;
+        double minValue;
+        double maxValue;
+        double sum;
+
+        ColumnStats();
+        double average() const;
+    };
+
+    DataAligner();
+
+    /**
+     * @brief 开始一次对齐
+     * @param policy 对齐策略
+     * @param axisMs 时间轴（毫秒，升序）
+     * @param toleranceMs 容差窗口
+     * @param columns 各查询列的结果数组（长度等于时间轴点数，调用方预先填充 NaN）
+     * @param cancelFlag 非零时尽快放弃剩余的列处理（可为空）
+     */
+    void begin(TimeRangeConfig::AlignPolicy policy, std::vector<int64_t> axisMs,
+        int64_t toleranceMs, const QVector<double*>& columns,
+        const QAtomicInt* cancelFlag = nullptr);
+
+    /**
+     * @brief 合并一段数据（段内时间戳升序）
+     */
+    void feed(const TaosColumnarData& chunk);
+
+    /**
+     * @brief 按水位线定稿时间轴前缀（清理非有限值、完成插值）
+     * @param watermarkMs 调用方保证之后到达的采样时间戳都不早于该值
+     * @return 已定稿的时间点数；结果数组中这些行此后不再被写入
+     */
+    int settle(int64_t watermarkMs);
+    int settledCount() const { return (int)m_settled; }
+
+    /**
+     * @brief 全部数据到达后调用：批量清理非有限值、完成插值并计算各列统计
+     * @return 被取消时返回 false（结果不完整）
+     */
+    bool finish();
+
+    /**
+     * @brief 第 column 个查询列的统计（finish() 之后有效）
+     */
+    const ColumnStats& stats(int column) const { return m_stats[m_primary[column]]; }
+
+    const std::vector<int64_t>& axis() const { return m_axisMs; }
+    int matchCount() const { return m_matchCount; }
+    size_t rowCount() const { return m_rowCount; }
+
+private:
+    static const int64_t kNone;     // 时间点尚无采样
+
+    bool isBetter(size_t i, int64_t candidateTs) const;
+    bool isCanceled() const;
+    bool postProcess(size_t from, size_t to);
+    void forEachColumn(size_t workPerColumn, const std::function<void(int)>& fn) const;
+    static void scrubNonFinite(double* values, size_t count);
+    static ColumnStats computeStats(const double* values, size_t count);
+
+    TimeRangeConfig::AlignPolicy m_policy;
+    std::vector<int64_t> m_axisMs;
+    int64_t m_toleranceMs;
+    QVector<double*> m_columns;
+    QVector<int> m_primary;                     // 每个查询列对应的首个共享同一结果数组的列
+    QVector<int> m_uniqueColumns;               // 互不相同的结果数组（取首次出现的列）
+    const QAtomicInt* m_cancelFlag;
+    std::vector<ColumnStats> m_stats;
+
+    std::vector<int64_t> m_chosenTs;            // 结果数组中当前值对应的采样时间（线性插值时为前侧）
+    std::vector<int64_t> m_nextTs;              // 仅线性插值：后侧采样时间
+    std::vector<std::vector<double>> m_nextValues;  // 仅线性插值：后侧采样值（按列）
+
+    std::vector<int32_t> m_pick;                // 本段内每个时间轴点采用的行号，-1 表示不更新
+    std::vector<int32_t> m_pickNext;            // 仅线性插值：后侧行号
+
+    size_t m_settled;                           // 已定稿的时间轴前缀长度
+    int m_matchCount;
+    size_t m_rowCount;
+};
+
+#endif // DATAALIGNER_H
@@ -9,6 +9,8 @@
 #include <QSet>
 #include <QColor>
 
+#include "CellValue.h"
+
 enum class RTBorderStyle {
     None = 0, Thin, Medium, Thick, Double, Dotted, Dashed
 };
@@ -83,6 +85,7 @@ struct CellData {
     // ===== ʾ㣨ûģ =====
     // ========================================
     QVariant displayValue;              // ʾֵ"202511", "123.45", ʽ
+    CellValue cellValue;                // ֵ㣺ѯʽԭʼȣNone ʾ displayValue ͣ
 
     // ========================================
     // ===== ǲ㣨߼õģ =====
@@ -90,6 +93,7 @@ struct CellData {
     QString markerText;                 // ԭʼǣ"#Date:2025-01-01", "#t#0:00", "#d#RTU001"
     CellType cellType;                  // Ԫ
     QString rtuId;                      // ݱǵRTUţmarkerText
+    int rtuKey;                         // RTUŵͱţ RtuDictionary 䣬-1 ʾޣ
 
     // ========================================
     // ===== ʽ =====
@@ -122,9 +126,11 @@ struct CellData {
     // ===== 캯 =====
     CellData()
         : displayValue()
+        , cellValue()
         , markerText()
         , cellType(NormalCell)
         , rtuId()
+        , rtuKey(-1)
         , hasFormula(false)
         , formula()
         , formulaCalculated(false)
@@ -216,6 +222,26 @@ struct CellData {
         return displayValue.toString();
     }
 
+    // ========================================
+    // ===== ֵ =====
+    // ========================================
+
+    /**
+     * ֵѯʽʾıֵʽ
+     */
+    void setValue(const CellValue& newValue) {
+        cellValue = newValue;
+        displayValue = newValue.toDisplayString();
+    }
+
+    /**
+     * ʾıǡʽıû룩ֵ
+     */
+    void setDisplayText(const QVariant& text) {
+        cellValue = CellValue();
+        displayValue = text;
+    }
+
     // ========================================
     // ===== ʽ =====
     // ========================================
@@ -235,9 +261,10 @@ struct CellData {
 struct ReportColumnConfig {
     QString displayName;  // ʾ
     QString rtuId;        // RTU
+    int rtuKey;           // RTUŵͱţ RtuDictionary 䣩
     int sourceRow;        // Դļкţѡ
 
-    ReportColumnConfig() : sourceRow(-1) {}
+    ReportColumnConfig() : rtuKey(-1), sourceRow(-1) {}
 };
 
 struct HistoryReportConfig {
@@ -248,9 +275,22 @@ struct HistoryReportConfig {
 };
 
 struct TimeRangeConfig {
+    // ʱԣ DataAligner
+    enum AlignPolicy {
+        AlignNearest = 0,   // 
+        AlignPrevious = 1,  // ǰֵʱ㣩
+        AlignNext = 2,      // ֵʱ㣩
+        AlignLinear = 3     // Բֵ
+    };
+
     QDateTime startTime;
     QDateTime endTime;
     int intervalSeconds;
+    int shardSeconds;       // Ƭʱ룩ʱȳֵʱΪӷΧѯ0 ʾƬ
+    int shardConcurrency;   // Ƭѯ󲢷
+    AlignPolicy alignPolicy; // 
+
+    TimeRangeConfig() : intervalSeconds(0), shardSeconds(24 * 3600), shardConcurrency(4), alignPolicy(AlignNearest) {}
 
     bool isValid() const {
         return startTime.isValid() &&
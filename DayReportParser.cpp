@@ -2,6 +2,9 @@
 #include "reportdatamodel.h"
 #include "DataBindingConfig.h"
 #include "TaosDataFetcher.h"
+#include "RtuDictionary.h"
+#include "TaosConnectionPool.h"
+#include "QueryPlanner.h"
 
 #include <qDebug>
 #include <QDate>
@@ -9,6 +12,7 @@
 #include <stdexcept>
 #include <QProgressDialog>
 #include <QtConcurrent>
+#include <QThreadPool>
 
 DayReportParser::DayReportParser(ReportDataModel* model, QObject* parent)
     : BaseReportParser(model, parent)
@@ -26,7 +30,8 @@ bool DayReportParser::scanAndParse()
     m_dateFound = false;
     m_baseDate.clear();
     m_currentTime.clear();
-    m_dataCache.clear();
+    clearTimeMarkerIndex();
+    clearCache();
 
     // 查找 #Date 标记
     if (!findDateMarker()) {
@@ -38,12 +43,11 @@ bool DayReportParser::scanAndParse()
 
     qDebug() << "基准日期:" << m_baseDate;
 
-    // 逐行解析
-    int totalRows = m_model->rowCount();
-    for (int row = 0; row < totalRows; ++row) {
-        parseRow(row);
-        emit parseProgress(row + 1, totalRows);
-    }
+    // 按行分区并行识别，再按行序串行写回
+    parseAllRows();
+
+    // 行内时间标记索引已建立，一次性确定所有任务的查询时刻
+    resolveTaskTimestamps();
 
     if (m_queryTasks.isEmpty()) {
         QString warnMsg = "警告：未找到任何数据标记";
@@ -54,9 +58,6 @@ bool DayReportParser::scanAndParse()
 
     qDebug() << "解析完成：找到" << m_queryTasks.size() << "个数据点";
 
-    setEditState(PREFETCHING);
-    m_model->updateEditability();  // 通知 Model 更新可编辑状态
-
     // 启动后台预查询
     qDebug() << "========== 开始后台预查询 ==========";
     startAsyncTask();
@@ -69,72 +70,67 @@ bool DayReportParser::scanAndParse()
     return true;
 }
 
-bool DayReportParser::runAsyncTask()
+bool DayReportParser::runAsyncTask(const PrefetchPlanPtr& plan)
 {
     qDebug() << "[后台线程] 日报预查询开始...";
+    if (!plan) {
+        qWarning() << "未生成预查询计划";
+        return false;
+    }
     // analyzeAndPrefetch 包含了取消检查
-    return this->analyzeAndPrefetch();
+    return this->analyzeAndPrefetch(*plan);
 }
 
 bool DayReportParser::findDateMarker()
 {
-    int totalRows = m_model->rowCount();
-    int totalCols = m_model->columnCount();
-
-    for (int row = 0; row < totalRows; ++row) {
-        for (int col = 0; col < totalCols; ++col) {
-            CellData* cell = m_model->getCell(row, col);
-            if (!cell) continue;
+    int foundRow = -1;
+    int foundCol = -1;
+    QString text;
 
-            // ===== 使用 scanText() 而不是 value.toString() =====
-            QString text = cell->scanText().trimmed();
+    // 并行查找行优先顺序下的第一个 #Date 标记
+    if (!findFirstCell([this](const QString& candidate) { return isDateMarker(candidate); },
+        foundRow, foundCol, text)) {
+        return false;
+    }
 
-            if (isDateMarker(text)) {
-                m_baseDate = extractDate(text);
+    m_baseDate = extractDate(text);
 
-                if (m_baseDate.isEmpty()) {
-                    return false;
-                }
+    if (m_baseDate.isEmpty()) {
+        return false;
+    }
 
-                m_dateFound = true;
-                cell->cellType = CellData::DateMarker;
-                cell->markerText = text;  // 保存原始标记
+    CellData* cell = m_model->getCell(foundRow, foundCol);
 
-                // 设置显示格式
-                cell->displayValue = text;
+    m_dateFound = true;
+    cell->cellType = CellData::DateMarker;
+    cell->markerText = text;  // 保存原始标记
 
-                QPoint pos(row, col);
-                m_scannedMarkers.insert(pos, text);
+    // 设置显示格式
+    cell->setDisplayText(text);
 
-                return true;
-            }
-        }
-    }
+    QPoint pos(foundRow, foundCol);
+    m_scannedMarkers.insert(pos, text);
 
-    return false;
+    return true;
 }
 
-void DayReportParser::parseRow(int row)
+void DayReportParser::parseRow(int row, const RowScan& scan)
 {
-    int totalCols = m_model->columnCount();
-
-    for (int col = 0; col < totalCols; ++col) {
+    for (const RowMarker& marker : scan) {
+        const int col = marker.col;
+        const QString& text = marker.text;
         CellData* cell = m_model->getCell(row, col);
-        if (!cell) continue;
-
-        // ===== 使用 scanText() =====
-        QString text = cell->scanText().trimmed();
-        if (text.isEmpty()) continue;
 
         // 遇到 #t# 时间标记
-        if (isTimeMarker(text)) {
-            QString timeStr = extractTime(text);
+        if (marker.kind == RowMarker::TimeMarker) {
+            const QString& timeStr = marker.value;
             // 检查提取是否成功
-            if(timeStr.isEmpty()) {
+            if (!marker.resolved || timeStr.isEmpty()) {
                 qWarning() << "行" << row << "列" << col << ": 无法从标记提取有效时间:" << text;
                 cell->cellType = CellData::TimeMarker; // 仍然标记为 TimeMarker
                 cell->markerText = text;
-                cell->displayValue = text; // 显示原始错误标记
+                cell->setDisplayText(text); // 显示原始错误标记
+                indexTimeMarker(row, col, QString());  // 无效标记同样遮挡其左侧的标记
 
                 continue; // 跳过 m_currentTime 设置
             }
@@ -142,21 +138,22 @@ void DayReportParser::parseRow(int row)
 
             cell->cellType = CellData::TimeMarker;
             cell->markerText = text;    // 设置 markerText
-            cell->displayValue = text; // <-- 修改：初始 displayValue 等于 markerText
+            cell->setDisplayText(text); // <-- 修改：初始 displayValue 等于 markerText
 
             QPoint pos(row, col);
             m_scannedMarkers.insert(pos, text);  // 使用完整的标记文本作为值
+            indexTimeMarker(row, col, timeStr);
 
             continue;
         }
         // 遇到 #d# 数据标记
-        else if (isDataMarker(text)) {
+        else {
             if (m_currentTime.isEmpty()) {
                 qWarning() << QString("行%1列%2 缺少时间信息，跳过").arg(row).arg(col);
                 continue;
             }
 
-            QString rtuId = extractRtuId(text);
+            const QString& rtuId = marker.value;
             if (rtuId.isEmpty()) {
                 qWarning() << QString("行%1列%2 RTU号为空，跳过").arg(row).arg(col);
                 continue;
@@ -165,12 +162,15 @@ void DayReportParser::parseRow(int row)
             cell->cellType = CellData::DataMarker;
             cell->markerText = text;                    // 保存原始标记
             cell->rtuId = rtuId;
-            cell->displayValue = text;                  // 初始显示标记
+            cell->rtuKey = RtuDictionary::instance().intern(rtuId);  // 串行驻留，键值顺序与逐行扫描一致
+            cell->setDisplayText(text);                  // 初始显示标记
 
             QueryTask task;
             task.cell = cell;
             task.row = row;
             task.col = col;
+            task.rtuKey = cell->rtuKey;
+            task.timestampMs = -1;  // 整表解析完成后统一确定
             task.queryPath = "";
 
             m_queryTasks.append(task);
@@ -183,45 +183,36 @@ void DayReportParser::parseRow(int row)
 
 QTime DayReportParser::getTaskTime(const QueryTask& task)
 {
-    int row = task.row;
-    int col = task.col;
-
-    qDebug() << QString("【getTaskTime】查找任务时间: row=%1, col=%2").arg(row).arg(col);
-
-    // ===== 【新增】打印该行所有单元格的类型 =====
-    qDebug() << QString("  → 扫描第%1行的所有单元格:").arg(row);
-    for (int c = 0; c < m_model->columnCount(); ++c) {
-        CellData* cell = m_model->getCell(row, c);
-        if (cell && !cell->displayText().isEmpty()) {
-            qDebug() << QString("    列%1: cellType=%2, markerText='%3', text='%4'")
-                .arg(c)
-                .arg((int)cell->cellType)
-                .arg(cell->markerText)
-                .arg(cell->displayText());
-        }
+    QString timeStr;
+    if (!lookupTimeMarker(task.row, task.col, timeStr)) {
+        qWarning() << QString("  → 行%1列%2 未找到时间标记！").arg(task.row).arg(task.col);
+        return QTime();
     }
-    // ==========================================
-
 
-    // 从数据标记的列向左查找
-    for (int c = col - 1; c >= 0; --c) {
-        CellData* cell = m_model->getCell(row, c);
-        if (!cell) continue;
-
-        if (cell && cell->cellType == CellData::TimeMarker) {
-            QString timeMarker = cell->markerText.isEmpty() ?
-                cell->displayValue.toString() :
-                cell->markerText;
+    return QTime::fromString(timeStr, "HH:mm:ss");
+}
 
-            QString timeStr = extractTime(timeMarker);
-            QTime time = QTime::fromString(timeStr, "HH:mm:ss");
+int64_t DayReportParser::resolveTaskTimestamp(const QueryTask& task) const
+{
+    QString timeStr;
+    if (!lookupTimeMarker(task.row, task.col, timeStr) || timeStr.isEmpty()) {
+        return -1;
+    }
 
-            return time;
-        }
+    QDate date = QDate::fromString(m_baseDate, "yyyy-MM-dd");
+    QTime time = QTime::fromString(timeStr, "HH:mm:ss");
+    if (!date.isValid() || !time.isValid()) {
+        return -1;
     }
 
-    qWarning() << QString("  → 未找到时间标记！");
-    return QTime();
+    return QDateTime(date, time).toMSecsSinceEpoch();
+}
+
+bool DayReportParser::resolveTimeMarker(const QString& markerText, QString& value) const
+{
+    // 无效的时间标记也加入索引（值为空），与原向左查找遇到首个时间标记即停止的行为一致
+    value = extractTime(markerText);
+    return true;
 }
 
 QVariant DayReportParser::formatDisplayValueForMarker(const CellData* cell) const
@@ -328,60 +319,12 @@ bool DayReportParser::executeQueries(QProgressDialog* progress)
 
     qDebug() << "========== 开始从缓存填充数据 ==========";
 
-
-    if (progress) {
-        progress->setRange(0, m_queryTasks.size());
-        progress->setLabelText("正在填充数据...");
-    }
-
     int successCount = 0;
     int failCount = 0;
-
-    for (int i = 0; i < m_queryTasks.size(); ++i) {
-        if (progress && progress->wasCanceled()) {
-            for (int j = i; j < m_queryTasks.size(); ++j) {
-                m_queryTasks[j].cell->queryExecuted = false;
-            }
-            return false;
-        }
-
-        const QueryTask& task = m_queryTasks[i];
-
-        QTime time = getTaskTime(task);
-        if (!time.isValid()) {
-            task.cell->displayValue = "N/A";
-            task.cell->queryExecuted = true;
-            task.cell->querySuccess = false;
-            failCount++;
-            continue;
-        }
-
-        QDateTime dateTime = QDateTime(
-            QDate::fromString(m_baseDate, "yyyy-MM-dd"),
-            time
-        );
-        int64_t timestamp = dateTime.toMSecsSinceEpoch();
-
-        float value = 0.0f;
-        // ===== 【修改】直接从缓存查找，不再检查 cacheReady =====
-        if (findInCache(task.cell->rtuId, timestamp, value)) {
-            task.cell->displayValue = QString::number(value, 'f', 2);
-            task.cell->queryExecuted = true;
-            task.cell->querySuccess = true;
-            successCount++;
-        }
-        else {
-            task.cell->displayValue = "N/A";
-            task.cell->queryExecuted = true;
-            task.cell->querySuccess = false;
-            failCount++;
-        }
-
-        if (progress) {
-            progress->setValue(i + 1);
-        }
-        emit queryProgress(i + 1, m_queryTasks.size());
+    if (!fillTasksFromCache(progress, successCount, failCount)) {
+        return false;
     }
+    emit queryProgress(m_queryTasks.size(), m_queryTasks.size());
 
     qDebug() << QString("填充完成: 成功 %1, 失败 %2").arg(successCount).arg(failCount);
     emit queryCompleted(successCount, failCount);
@@ -410,38 +353,11 @@ QString DayReportParser::extractDate(const QString& text) const
 
 QString DayReportParser::findTimeForDataMarker(int row, int col)
 {
-    qDebug() << QString("【查找时间】为数据标记 [%1,%2] 查找时间标记").arg(row).arg(col);
-
-    for (int c = col - 1; c >= 0; --c) {
-        CellData* cell = m_model->getCell(row, c);
-        if (!cell) continue;
-
-        // 检查 cellType
-        if (cell->cellType == CellData::TimeMarker) {
-            // ===== 【修改】从 markerText 提取，而不是直接用 displayValue =====
-            QString markerText = cell->markerText.isEmpty() ?
-                cell->displayValue.toString() :
-                cell->markerText;
-
-            QString timeStr = extractTime(markerText);  // ← 统一使用 extractTime
-
-            qDebug() << QString("  → 通过 cellType 找到时间标记：列%1, markerText='%2', 提取时间='%3'")
-                .arg(c).arg(markerText).arg(timeStr);
-            return timeStr;
-        }
-
-        // 检查文本内容
-        QString text = cell->displayText().trimmed();
-        if (isTimeMarker(text)) {
-            QString timeStr = extractTime(text);
-            qDebug() << QString("  → 通过文本识别时间标记：列%1, text='%2', 提取时间='%3'")
-                .arg(c).arg(text).arg(timeStr);
-            return timeStr;
-        }
+    QString timeStr;
+    if (!lookupTimeMarker(row, col, timeStr)) {
+        qWarning() << QString("  → 数据标记[%1,%2]左侧未找到时间标记！").arg(row).arg(col);
     }
-
-    qWarning() << QString("  → 未找到时间标记！");
-    return QString();
+    return timeStr;
 }
 
 QList<BaseReportParser::TimeBlock> DayReportParser::identifyTimeBlocks()
@@ -471,138 +387,146 @@ QList<BaseReportParser::TimeBlock> DayReportParser::identifyTimeBlocks()
         return blocks;
     }
 
-    // 识别连续块
-    TimeBlock currentBlock;
-    currentBlock.startTime = sortedTasks[0].first;
-    currentBlock.endTime = sortedTasks[0].first;
-    currentBlock.taskIndices.append(sortedTasks[0].second);
-
-    const int CONTINUITY_THRESHOLD = 5 * 60;  // 5分钟
-
-    for (int i = 1; i < sortedTasks.size(); ++i) {
-        QTime time = sortedTasks[i].first;
-        int taskIdx = sortedTasks[i].second;
-        int gapSeconds = currentBlock.endTime.secsTo(time);
-
-        if (gapSeconds <= CONTINUITY_THRESHOLD) {
-            currentBlock.endTime = time;
-            currentBlock.taskIndices.append(taskIdx);
-        }
-        else {
-            blocks.append(currentBlock);
-            currentBlock = TimeBlock();
-            currentBlock.startTime = time;
-            currentBlock.endTime = time;
-            currentBlock.taskIndices.append(taskIdx);
+    // 统计参与查询的RTU数，交给规划器按代价模型决定分块
+    QSet<int> uniqueRTUs;
+    for (const QueryTask& task : m_queryTasks) {
+        if (task.rtuKey >= 0) {
+            uniqueRTUs.insert(task.rtuKey);
         }
     }
 
-    blocks.append(currentBlock);
+    // 日报查询终点额外读取60秒（见 buildBlockQuery）
+    QueryPlanner::Plan plan = QueryPlanner::instance().plan(sortedTasks,
+        uniqueRTUs.size(), getQueryIntervalSeconds(), 60);
+    qDebug().noquote() << plan.describe();
+
+    for (const QueryPlanner::PlannedQuery& query : plan.queries) {
+        TimeBlock block;
+        block.startTime = query.startTime;
+        block.endTime = query.endTime;
+        block.taskIndices = query.taskIndices;
+        blocks.append(block);
+    }
 
     return blocks;
 }
 
-bool DayReportParser::analyzeAndPrefetch()
+BaseReportParser::PrefetchPlanPtr DayReportParser::buildPrefetchPlan()
 {
-    // 1. 识别时间块
-    QList<TimeBlock> blocks = identifyTimeBlocks();
-
-    if (m_cancelRequested.loadAcquire()) return false;
+    std::shared_ptr<PrefetchPlan> plan = std::make_shared<PrefetchPlan>();
 
-    if (blocks.isEmpty()) {
-        qWarning() << "未识别到有效时间块";
-        return false;
-    }
+    // 1. 识别时间块（读取任务列表和行内时间标记索引，必须在 GUI 线程完成）
+    QList<TimeBlock> blocks = identifyTimeBlocks();
 
     // 2. 收集所有唯一的RTU
-    QSet<QString> uniqueRTUs;
+    QSet<int> uniqueRTUs;
     for (const QueryTask& task : m_queryTasks) {
-        uniqueRTUs.insert(task.cell->rtuId);
+        if (task.rtuKey >= 0) {
+            uniqueRTUs.insert(task.rtuKey);
+        }
     }
-    QString rtuList = uniqueRTUs.values().join(",");
-
-    qDebug() << "RTU数量：" << uniqueRTUs.size();
-
-    // 3. 决策查询策略
-    QList<TimeBlock> mergedBlocks;
+    plan->rtuKeys = uniqueRTUs.values().toVector();
+    std::sort(plan->rtuKeys.begin(), plan->rtuKeys.end());
+    for (int rtuKey : plan->rtuKeys) {
+        plan->rtuNames.append(RtuDictionary::instance().name(rtuKey));
+    }
+    plan->intervalSeconds = getQueryIntervalSeconds();
 
-    if (blocks.size() == 1) {
-        mergedBlocks.append(blocks[0]);
+    // 3. 时间块已由查询规划器按代价模型合并，这里直接展开成查询地址
+    for (int i = 0; i < blocks.size(); ++i) {
+        const TimeBlock& block = blocks[i];
+        plan->blockQueries.append(buildBlockQuery(plan->rtuKeys, block.startTime,
+            block.endTime, plan->intervalSeconds));
+        qDebug() << QString("查询计划 %1/%2: %3 ~ %4")
+            .arg(i + 1)
+            .arg(blocks.size())
+            .arg(block.startTime.toString("HH:mm"))
+            .arg(block.endTime.toString("HH:mm"));
     }
-    else {
-        TimeBlock currentMerged = blocks[0];
 
-        for (int i = 1; i < blocks.size(); ++i) {
-            if (shouldMergeBlocks(currentMerged, blocks[i])) {
+    qDebug() << "RTU数量：" << plan->rtuKeys.size() << "，查询策略：" << plan->blockQueries.size() << "次查询";
+    return plan;
+}
+
+bool DayReportParser::analyzeAndPrefetch(const PrefetchPlan& plan)
+{
+    if (m_cancelRequested.loadAcquire()) return false;
 
-                currentMerged.endTime = blocks[i].endTime;
-                currentMerged.taskIndices.append(blocks[i].taskIndices);
-            }
-            else {
-                mergedBlocks.append(currentMerged);
-                currentMerged = blocks[i];
-            }
-        }
-        mergedBlocks.append(currentMerged);
+    if (plan.blockQueries.isEmpty()) {
+        qWarning() << "未识别到有效时间块";
+        return false;
     }
 
-    qDebug() << "查询策略：" << mergedBlocks.size() << "次查询";
+    // 并发执行查询：工作线程只读取数据，不触碰缓存锁
+    const int totalCount = plan.blockQueries.size();
+    const int workerCount = qBound(1, TaosConnectionPool::instance().maxSize(), totalCount);
+
+    struct BlockOutcome {
+        bool success = false;
+        TaosColumnarData data;
+    };
+
+    QAtomicInt finishedCount(0);
+    QAtomicInt successCount(0);
+    QThreadPool blockPool;
+    blockPool.setMaxThreadCount(workerCount);
+
+    QVector<QFuture<BlockOutcome>> futures;
+    futures.reserve(totalCount);
+    for (int i = 0; i < totalCount; ++i) {
+        const QString query = plan.blockQueries.at(i);
+        futures.append(QtConcurrent::run(&blockPool,
+            [this, query, totalCount, &finishedCount, &successCount]() {
+                BlockOutcome outcome;
+                if (m_cancelRequested.loadAcquire()) {
+                    return outcome;
+                }
 
-    // 4. 执行查询
-    int successCount = 0;  // 改用成功计数
-    int failCount = 0;     // 失败计数
-    int intervalSeconds = getQueryIntervalSeconds();
+                double readElapsedMs = 0.0;
+                outcome.success = fetchBlock(query, outcome.data, &readElapsedMs);
+                if (outcome.success) {
+                    successCount.fetchAndAddOrdered(1);
+                    // 用借到连接之后的实际读取耗时校准规划器的代价模型（不含排队等待连接）
+                    QueryPlanner::instance().recordObservation(outcome.data.rowCount(),
+                        (int)outcome.data.columnCount(), readElapsedMs);
+                }
+                else {
+                    qWarning() << "查询失败";
+                }
 
-    for (int i = 0; i < mergedBlocks.size(); ++i) {
-        if (m_cancelRequested.loadAcquire()) {
-            qDebug() << "后台查询被中断";
-            m_lastPrefetchSuccessCount = successCount;
-            m_lastPrefetchTotalCount = mergedBlocks.size();
-            return false;
-        }
-        const TimeBlock& block = mergedBlocks[i];
-
-        if (block.isDateRange()) {
-            qDebug() << QString("执行查询 %1/%2: %3 %4 ~ %5 %6")
-                .arg(i + 1)
-                .arg(mergedBlocks.size())
-                .arg(block.startDate)
-                .arg(block.startTime.toString("HH:mm"))
-                .arg(block.endDate)
-                .arg(block.endTime.toString("HH:mm"));
-        }
-        else {
-            qDebug() << QString("执行查询 %1/%2: %3 ~ %4")
-                .arg(i + 1)
-                .arg(mergedBlocks.size())
-                .arg(block.startTime.toString("HH:mm"))
-                .arg(block.endTime.toString("HH:mm"));
-        }
+                // 进度按完成数上报，与原串行语义一致（current 单调递增至 total）
+                emit taskProgress(finishedCount.fetchAndAddOrdered(1) + 1, totalCount);
+                return outcome;
+            }));
+    }
 
+    blockPool.waitForDone();
 
-        emit taskProgress(i + 1, mergedBlocks.size());
+    if (m_cancelRequested.loadAcquire()) {
+        qDebug() << "后台查询被中断";
+        m_lastPrefetchSuccessCount = successCount.loadAcquire();
+        m_lastPrefetchTotalCount = totalCount;
+        return false;
+    }
 
-        bool success = executeSingleQuery(rtuList,
-            block.startTime,
-            block.endTime,
-            intervalSeconds);
+    QueryPlanner::instance().save();
 
-        if (success) {
-            successCount++;
-        }
-        else {
-            qWarning() << "查询失败";
-            failCount++;
+    // 全部完成后按时间顺序一次性合并入缓存
+    for (int i = 0; i < totalCount; ++i) {
+        BlockOutcome outcome = futures[i].result();
+        futures[i] = QFuture<BlockOutcome>();
+        if (outcome.success) {
+            mergeIntoCache(plan.rtuKeys, outcome.data);
         }
     }
 
     // 记录统计信息
-    qDebug() << QString("预查询完成: 成功 %1/%2").arg(successCount).arg(mergedBlocks.size());
-    m_lastPrefetchSuccessCount = successCount;
-    m_lastPrefetchTotalCount = mergedBlocks.size();
+    qDebug() << QString("预查询完成: 成功 %1/%2").arg(successCount.loadAcquire()).arg(totalCount);
+    m_lastPrefetchSuccessCount = successCount.loadAcquire();
+    m_lastPrefetchTotalCount = totalCount;
 
     // 只要有一次成功就返回 true
-    return successCount > 0;
+    return successCount.loadAcquire() > 0;
 }
 
 void DayReportParser::collectActualDays()
@@ -611,28 +535,37 @@ void DayReportParser::collectActualDays()
 
     qDebug() << "开始收集日报日期标记...";
 
-    for (int row = 0; row < m_model->rowCount(); ++row) {
-        for (int col = 0; col < m_model->columnCount(); ++col) {
-            CellData* cell = m_model->getCell(row, col);
+    const int totalCols = m_model->columnCount();
+    const QVector<QPair<int, int>> partitions = partitionRows(m_model->rowCount());
 
-            // 检查是否为日期标记
-            if (cell && cell->cellType == CellData::DateMarker) {
-                QString markerText = cell->markerText;
+    // 各分区收集到本地集合，结束后合并，避免加锁
+    QVector<QSet<QDate>> localDays(partitions.size());
+    QSet<QDate>* buckets = localDays.data();
 
-                if (markerText.startsWith("#Date:", Qt::CaseInsensitive)) {
-                    QString dateStr = markerText.mid(6).trimmed();  // 去掉 "#Date:" 前缀
-                    QDate date = QDate::fromString(dateStr, "yyyy-MM-dd");
+    runPartitions(partitions.size(), [this, &partitions, totalCols, buckets](int index) {
+        for (int row = partitions[index].first; row < partitions[index].second; ++row) {
+            for (int col = 0; col < totalCols; ++col) {
+                const CellData* cell = m_model->getCell(row, col);
 
-                    if (date.isValid()) {
-                        if (!m_actualDays.contains(date)) {
-                            m_actualDays.insert(date);
-                            qDebug() << QString("  收集日期: 行%1列%2, date=%3")
-                                .arg(row).arg(col).arg(date.toString("yyyy-MM-dd"));
+                // 检查是否为日期标记
+                if (cell && cell->cellType == CellData::DateMarker) {
+                    const QString& markerText = cell->markerText;
+
+                    if (markerText.startsWith("#Date:", Qt::CaseInsensitive)) {
+                        QString dateStr = markerText.mid(6).trimmed();  // 去掉 "#Date:" 前缀
+                        QDate date = QDate::fromString(dateStr, "yyyy-MM-dd");
+
+                        if (date.isValid()) {
+                            buckets[index].insert(date);
                         }
                     }
                 }
             }
         }
+    });
+
+    for (const QSet<QDate>& days : localDays) {
+        m_actualDays.unite(days);
     }
 
     qDebug() << QString("日报日期收集完成：共 %1 个").arg(m_actualDays.size());
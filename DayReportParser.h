@@ -27,23 +27,26 @@ public:
 
     QString extractTime(const QString& text) const override; // 确保声明存在
 
-    bool analyzeAndPrefetch() override;
+    bool analyzeAndPrefetch(const PrefetchPlan& plan) override;
     QList<BaseReportParser::TimeBlock> identifyTimeBlocks() override;
 
     void collectActualDays();
 protected:
     // ===== 实现纯虚函数 =====
     bool findDateMarker() override;
-    void parseRow(int row) override;
+    void parseRow(int row, const RowScan& scan) override;
     QTime getTaskTime(const QueryTask& task) override;
+    int64_t resolveTaskTimestamp(const QueryTask& task) const override;
     QDateTime constructDateTime(const QString& date, const QString& time) override;
     int getQueryIntervalSeconds() const override { return 60; }  // 日报间隔60秒
 
     void restoreToTemplate() override {};
 
-    bool runAsyncTask() override;
+    PrefetchPlanPtr buildPrefetchPlan() override;
+    bool runAsyncTask(const PrefetchPlanPtr& plan) override;
 
     QString findTimeForDataMarker(int row, int col) override;
+    bool resolveTimeMarker(const QString& markerText, QString& value) const override;
 
     void onRescanCompleted(int newCount, int modifiedCount, int removedCount,
         const QSet<int>& affectedRows) override;
@@ -0,0 +1,165 @@
+#include "FormulaDependencyGraph.h"
+#include "reportdatamodel.h"    // qHash(QPoint)
+
+#include <algorithm>
+
+void FormulaDependencyGraph::setFormula(const QPoint& cell, const CompiledFormula& formula)
+{
+    removeFormula(cell);
+
+    Node node;
+    if (formula.kind == CompiledFormula::Expression) {
+        for (const CompiledFormula::Instruction& ins : formula.program) {
+            if (ins.op != CompiledFormula::PushCell) continue;
+
+            const QPoint ref(ins.row, ins.col);
+            if (!node.cells.contains(ref)) {
+                node.cells.append(ref);
+                m_dependents[ref].append(cell);
+            }
+        }
+    }
+    else if (formula.kind == CompiledFormula::RangeFunction &&
+        formula.rangeStart.x() >= 0 && formula.rangeEnd.x() >= 0) {
+        node.hasRange = true;
+        node.rangeStart = formula.rangeStart;
+        node.rangeEnd = formula.rangeEnd;
+        for (int col = formula.rangeStart.y(); col <= formula.rangeEnd.y(); ++col) {
+            m_rangeDependents[col].append({ formula.rangeStart.x(), formula.rangeEnd.x(), cell });
+        }
+    }
+
+    m_precedents.insert(cell, node);
+}
+
+void FormulaDependencyGraph::removeFormula(const QPoint& cell)
+{
+    auto it = m_precedents.find(cell);
+    if (it == m_precedents.end()) {
+        return;
+    }
+
+    for (const QPoint& ref : it->cells) {
+        auto depIt = m_dependents.find(ref);
+        if (depIt == m_dependents.end()) continue;
+
+        depIt->removeAll(cell);
+        if (depIt->isEmpty()) {
+            m_dependents.erase(depIt);
+        }
+    }
+
+    if (it->hasRange) {
+        for (int col = it->rangeStart.y(); col <= it->rangeEnd.y(); ++col) {
+            auto rangeIt = m_rangeDependents.find(col);
+            if (rangeIt == m_rangeDependents.end()) continue;
+
+            QVector<RangeEdge>& edges = *rangeIt;
+            edges.erase(std::remove_if(edges.begin(), edges.end(),
+                [&cell](const RangeEdge& edge) { return edge.owner == cell; }), edges.end());
+            if (edges.isEmpty()) {
+                m_rangeDependents.erase(rangeIt);
+            }
+        }
+    }
+
+    m_precedents.erase(it);
+}
+
+void FormulaDependencyGraph::clear()
+{
+    m_precedents.clear();
+    m_dependents.clear();
+    m_rangeDependents.clear();
+}
+
+void FormulaDependencyGraph::appendDependents(const QPoint& cell, QVector<QPoint>& out) const
+{
+    auto depIt = m_dependents.constFind(cell);
+    if (depIt != m_dependents.constEnd()) {
+        out += depIt.value();
+    }
+
+    auto rangeIt = m_rangeDependents.constFind(cell.y());
+    if (rangeIt != m_rangeDependents.constEnd()) {
+        for (const RangeEdge& edge : rangeIt.value()) {
+            if (cell.x() >= edge.firstRow && cell.x() <= edge.lastRow) {
+                out.append(edge.owner);
+            }
+        }
+    }
+}
+
+QVector<QVector<QPoint>> FormulaDependencyGraph::evaluationLevels(const QSet<QPoint>& seeds, QVector<QPoint>& cyclic) const
+{
+    // ===== 1. 收集受影响的子图（只含公式单元格），同时记录后继 =====
+    QVector<QPoint> nodes;
+    QHash<QPoint, int> indexOf;
+    for (const QPoint& seed : seeds) {
+        if (m_precedents.contains(seed) && !indexOf.contains(seed)) {
+            indexOf.insert(seed, nodes.size());
+            nodes.append(seed);
+        }
+    }
+
+    QVector<QVector<int>> successors;
+    for (int i = 0; i < nodes.size(); ++i) {
+        QVector<QPoint> dependents;
+        appendDependents(nodes[i], dependents);
+
+        QVector<int> next;
+        next.reserve(dependents.size());
+        for (const QPoint& dep : dependents) {
+            auto idxIt = indexOf.constFind(dep);
+            if (idxIt == indexOf.constEnd()) {
+                idxIt = indexOf.insert(dep, nodes.size());
+                nodes.append(dep);
+            }
+            next.append(idxIt.value());
+        }
+        successors.append(next);
+    }
+
+    // ===== 2. 子图内的入度 =====
+    QVector<int> indegree(nodes.size(), 0);
+    for (const QVector<int>& next : successors) {
+        for (int j : next) {
+            indegree[j]++;
+        }
+    }
+
+    // ===== 3. Kahn 拓扑排序：每轮取出当前入度为0的全部公式作为一层 =====
+    QVector<int> ready;
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (indegree[i] == 0) {
+            ready.append(i);
+        }
+    }
+
+    QVector<QVector<QPoint>> levels;
+    while (!ready.isEmpty()) {
+        QVector<QPoint> level;
+        level.reserve(ready.size());
+        QVector<int> next;
+        for (int i : ready) {
+            level.append(nodes[i]);
+            for (int j : successors[i]) {
+                if (--indegree[j] == 0) {
+                    next.append(j);
+                }
+            }
+        }
+        levels.append(level);
+        ready.swap(next);
+    }
+
+    // 入度始终不为0的公式位于环上或依赖环上的公式
+    cyclic.clear();
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (indegree[i] > 0) {
+            cyclic.append(nodes[i]);
+        }
+    }
+
+    return levels;
+}
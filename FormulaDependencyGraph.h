@@ -0,0 +1,68 @@
+#pragma once
+#ifndef FORMULADEPENDENCYGRAPH_H
+#define FORMULADEPENDENCYGRAPH_H
+
+#include "formulaengine.h"
+
+#include <QHash>
+#include <QSet>
+#include <QPoint>
+#include <QVector>
+
+/**
+ * @brief 公式依赖图
+ * 维护每个公式单元格引用的单元格（前驱）以及反向的“被谁引用”（后继）关系。
+ * 单元格引用按单元格建边；区域引用（SUM/MAX/MIN）按列登记行区间，不展开为逐格的边。
+ * 公式文本变化时由模型调用 setFormula()/removeFormula() 增量更新。
+ * 坐标均为 (行, 列)，0基。
+ */
+class FormulaDependencyGraph
+{
+public:
+    /**
+     * @brief 登记（或替换）公式单元格的引用关系
+     */
+    void setFormula(const QPoint& cell, const CompiledFormula& formula);
+
+    /**
+     * @brief 删除公式单元格的引用关系（单元格不再是公式时调用）
+     */
+    void removeFormula(const QPoint& cell);
+
+    void clear();
+    bool contains(const QPoint& cell) const { return m_precedents.contains(cell); }
+
+    /**
+     * @brief 直接引用 cell 的公式单元格（含区域引用）
+     */
+    void appendDependents(const QPoint& cell, QVector<QPoint>& out) const;
+
+    /**
+     * @brief 计算层次：从 seeds 出发沿引用关系收集所有受影响的公式，按拓扑序（Kahn）逐层排列
+     * 同一层内的公式互不引用，只依赖更早层次的结果，可以并行计算
+     * @param seeds 需要重新计算的公式单元格
+     * @param cyclic 输出处于循环引用中（或依赖循环引用）的公式单元格
+     * @return 依次计算的各层公式单元格
+     */
+    QVector<QVector<QPoint>> evaluationLevels(const QSet<QPoint>& seeds, QVector<QPoint>& cyclic) const;
+
+private:
+    struct Node {
+        QVector<QPoint> cells;      // 引用的单元格（去重）
+        bool hasRange = false;
+        QPoint rangeStart;          // 区域引用左上角
+        QPoint rangeEnd;            // 区域引用右下角
+    };
+
+    struct RangeEdge {
+        int firstRow;
+        int lastRow;
+        QPoint owner;               // 引用该区域的公式单元格
+    };
+
+    QHash<QPoint, Node> m_precedents;                   // 公式单元格 → 引用
+    QHash<QPoint, QVector<QPoint>> m_dependents;        // 单元格 → 直接引用它的公式
+    QHash<int, QVector<RangeEdge>> m_rangeDependents;   // 列 → 覆盖该列的区域引用
+};
+
+#endif // FORMULADEPENDENCYGRAPH_H
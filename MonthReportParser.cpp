@@ -2,6 +2,7 @@
 #include "reportdatamodel.h"
 #include "DataBindingConfig.h"
 #include "TaosDataFetcher.h"
+#include "RtuDictionary.h"
 
 #include <qDebug>
 #include <QDate>
@@ -28,7 +29,8 @@ bool MonthReportParser::scanAndParse()
     m_baseYearMonth.clear();
     m_baseTime.clear();
     m_currentTime.clear();
-    m_dataCache.clear();
+    clearTimeMarkerIndex();
+    clearCache();
 
     // 查找 #Date1 和 #Date2 标记
     if (!findDateMarker()) {
@@ -38,12 +40,11 @@ bool MonthReportParser::scanAndParse()
         return false;
     }
 
-    // 逐行解析
-    int totalRows = m_model->rowCount();
-    for (int row = 0; row < totalRows; ++row) {
-        parseRow(row);
-        emit parseProgress(row + 1, totalRows);
-    }
+    // 按行分区并行识别，再按行序串行写回
+    parseAllRows();
+
+    // 行内时间标记索引已建立，一次性确定所有任务的查询时刻
+    resolveTaskTimestamps();
 
     if (m_queryTasks.isEmpty()) {
         QString warnMsg = "警告：未找到任何数据标记";
@@ -61,9 +62,6 @@ bool MonthReportParser::scanAndParse()
         return true;
     }
 
-    setEditState(PREFETCHING);
-    m_model->updateEditability();
-
     // 启动后台预查询
     qDebug() << "========== 开始后台预查询 ==========";
     startAsyncTask(); // 调用基类方法启动后台任务
@@ -76,70 +74,64 @@ bool MonthReportParser::scanAndParse()
     return true;
 }
 
-bool MonthReportParser::runAsyncTask()
+bool MonthReportParser::runAsyncTask(const PrefetchPlanPtr& plan)
 {
-    qDebug() << "[后台线程] 日报预查询开始...";
+    qDebug() << "[后台线程] 月报预查询开始...";
+    if (!plan) {
+        qWarning() << "未生成预查询计划";
+        return false;
+    }
     // analyzeAndPrefetch 包含了取消检查
-    return this->analyzeAndPrefetch();
+    return this->analyzeAndPrefetch(*plan);
 }
 
 bool MonthReportParser::findDateMarker()
 {
-    int totalRows = m_model->rowCount();
-    int totalCols = m_model->columnCount();
-
-    bool foundDate1 = false;
-    bool foundDate2 = false;
-
-    for (int row = 0; row < totalRows; ++row) {
-        for (int col = 0; col < totalCols; ++col) {
-            CellData* cell = m_model->getCell(row, col);
-            if (!cell) continue;
-
-            // ===== 使用 scanText() =====
-            QString text = cell->scanText().trimmed();
-
-            // 查找 #Date1:2024-01
-            if (isDate1Marker(text)) {
-                m_baseYearMonth = extractYearMonth(text);
-
-                if (m_baseYearMonth.isEmpty()) {
-                    qWarning() << "年月格式错误:" << text;
-                    return false;
-                }
-
-                cell->cellType = CellData::DateMarker;
-                cell->markerText = text;  // 保存原始标记
-                cell->displayValue = text; 
+    int row = -1;
+    int col = -1;
+    QString text;
+
+    // 查找 #Date1:2024-01（并行查找行优先顺序下的第一个）
+    bool foundDate1 = findFirstCell([this](const QString& candidate) { return isDate1Marker(candidate); },
+        row, col, text);
+    if (foundDate1) {
+        m_baseYearMonth = extractYearMonth(text);
+
+        if (m_baseYearMonth.isEmpty()) {
+            qWarning() << "年月格式错误:" << text;
+            return false;
+        }
 
-                QPoint pos(row, col);
-                m_scannedMarkers.insert(pos, text);
+        CellData* cell = m_model->getCell(row, col);
+        cell->cellType = CellData::DateMarker;
+        cell->markerText = text;  // 保存原始标记
+        cell->setDisplayText(text);
 
-                foundDate1 = true;
-            }
-            // 查找 #Date2:08:30
-            else if (isDate2Marker(text)) {
-                m_baseTime = extractTimeOfDay(text);
+        QPoint pos(row, col);
+        m_scannedMarkers.insert(pos, text);
+    }
 
-                if (m_baseTime.isEmpty()) {
-                    qWarning() << "时间格式错误:" << text;
-                    return false;
-                }
+    // 查找 #Date2:08:30
+    bool foundDate2 = findFirstCell([this](const QString& candidate) { return isDate2Marker(candidate); },
+        row, col, text);
+    if (foundDate2) {
+        m_baseTime = extractTimeOfDay(text);
 
-                cell->cellType = CellData::TimeMarker;
-                cell->markerText = text;                // 保存原始标记
-                cell->displayValue = text;
+        if (m_baseTime.isEmpty()) {
+            qWarning() << "时间格式错误:" << text;
+            return false;
+        }
 
-                foundDate2 = true;
-            }
+        CellData* cell = m_model->getCell(row, col);
+        cell->cellType = CellData::TimeMarker;
+        cell->markerText = text;                // 保存原始标记
+        cell->setDisplayText(text);
+    }
 
-            // 如果两个都找到了，可以提前退出
-            if (foundDate1 && foundDate2) {
-                m_dateFound = true;
-                m_baseDate = m_baseYearMonth;
-                return true;
-            }
-        }
+    if (foundDate1 && foundDate2) {
+        m_dateFound = true;
+        m_baseDate = m_baseYearMonth;
+        return true;
     }
 
     if (!foundDate1) {
@@ -149,7 +141,7 @@ bool MonthReportParser::findDateMarker()
         qWarning() << "未找到 #Date2 标记";
     }
 
-    return foundDate1 && foundDate2;
+    return false;
 }
 
 QVariant MonthReportParser::formatDisplayValueForMarker(const CellData* cell) const
@@ -215,21 +207,19 @@ QVariant MonthReportParser::formatDisplayValueForMarker(const CellData* cell) co
     return cell->markerText;
 }
 
-void MonthReportParser::parseRow(int row)
+void MonthReportParser::parseRow(int row, const RowScan& scan)
 {
-    int totalCols = m_model->columnCount();
-
-    for (int col = 0; col < totalCols; ++col) {
+    for (const RowMarker& marker : scan) {
+        const int col = marker.col;
+        const QString& text = marker.text;
         CellData* cell = m_model->getCell(row, col);
-        if (!cell) continue;
-
-        // ===== 使用 scanText() =====
-        QString text = cell->scanText().trimmed();
-        if (text.isEmpty()) continue;
 
         // 遇到 #t# 日期标记（月报中表示"日"）
-        if (isTimeMarker(text)) {
-            int day = extractDay(text);
+        if (marker.kind == RowMarker::TimeMarker) {
+            int day = marker.resolved ? marker.value.toInt() : extractDay(text);
+            if (marker.resolved) {
+                indexTimeMarker(row, col, marker.value);
+            }
 
             // 验证日期是否有效
             QDate date = QDate::fromString(
@@ -238,7 +228,7 @@ void MonthReportParser::parseRow(int row)
             if (!date.isValid()) {
                 cell->cellType = CellData::TimeMarker;
                 cell->markerText = text;
-                cell->displayValue = text; // <-- 修改
+                cell->setDisplayText(text); // <-- 修改
                 continue;
             }
 
@@ -247,19 +237,19 @@ void MonthReportParser::parseRow(int row)
 
             cell->cellType = CellData::TimeMarker;
             cell->markerText = text;                    // 保存原始标记
-            cell->displayValue = text; // <-- 修改
+            cell->setDisplayText(text); // <-- 修改
 
             QPoint pos(row, col);
             m_scannedMarkers.insert(pos, text);  // 使用完整的标记文本作为值
         }
         // 遇到 #d# 数据标记
-        else if (isDataMarker(text)) {
+        else {
             if (m_currentTime.isEmpty()) {
                 qWarning() << QString("行%1列%2 缺少日期信息，跳过").arg(row).arg(col);
                 continue;
             }
 
-            QString rtuId = extractRtuId(text);
+            const QString& rtuId = marker.value;
             if (rtuId.isEmpty()) {
                 qWarning() << QString("行%1列%2 RTU号为空，跳过").arg(row).arg(col);
                 continue;
@@ -268,12 +258,15 @@ void MonthReportParser::parseRow(int row)
             cell->cellType = CellData::DataMarker;
             cell->markerText = text;      // 保存原始标记
             cell->rtuId = rtuId;
-            cell->displayValue = text;    // 初始显示标记
+            cell->rtuKey = RtuDictionary::instance().intern(rtuId);  // 串行驻留，键值顺序与逐行扫描一致
+            cell->setDisplayText(text);    // 初始显示标记
 
             QueryTask task;
             task.cell = cell;
             task.row = row;
             task.col = col;
+            task.rtuKey = cell->rtuKey;
+            task.timestampMs = -1;  // 整表解析完成后统一确定
             task.queryPath = "";
 
             m_queryTasks.append(task);
@@ -292,6 +285,28 @@ QTime MonthReportParser::getTaskTime(const QueryTask& task)
     return time;
 }
 
+int64_t MonthReportParser::resolveTaskTimestamp(const QueryTask& task) const
+{
+    // 月报：#t# 标记给出日，#Date1 给出年月，#Date2 给出固定的时刻
+    QString dayStr;
+    if (!lookupTimeMarker(task.row, task.col, dayStr)) {
+        return -1;
+    }
+
+    QDate date = QDate::fromString(
+        m_baseYearMonth + QString("-%1").arg(dayStr.toInt(), 2, 10, QChar('0')),
+        "yyyy-MM-dd");
+    QTime time = QTime::fromString(m_baseTime, "HH:mm:ss");
+    if (!time.isValid()) {
+        time = QTime::fromString(m_baseTime, "HH:mm");
+    }
+    if (!date.isValid() || !time.isValid()) {
+        return -1;
+    }
+
+    return QDateTime(date, time).toMSecsSinceEpoch();
+}
+
 QDateTime MonthReportParser::constructDateTime(const QString& date, const QString& time)
 {
     // date: "2024-01-15" (年月日)
@@ -317,83 +332,12 @@ bool MonthReportParser::executeQueries(QProgressDialog* progress)
 
     qDebug() << "========== 开始从缓存填充月报数据 ==========";
 
-
-    if (progress) {
-        progress->setRange(0, m_queryTasks.size());
-        progress->setLabelText("正在填充月报数据...");
-    }
-
     int successCount = 0;
     int failCount = 0;
-
-    for (int i = 0; i < m_queryTasks.size(); ++i) {
-        if (progress && progress->wasCanceled()) {
-            for (int j = i; j < m_queryTasks.size(); ++j) {
-                m_queryTasks[j].cell->queryExecuted = false;
-            }
-            return false;
-        }
-
-        const QueryTask& task = m_queryTasks[i];
-
-        // 从任务所在行找到日期标记
-        int day = 0;
-        int totalCols = m_model->columnCount();
-        for (int col = 0; col < totalCols; ++col) {
-            CellData* cell = m_model->getCell(task.row, col);
-            if (cell && cell->cellType == CellData::TimeMarker) {
-                QString dayStr = cell->displayValue.toString();  // 使用 displayValue
-                day = dayStr.toInt();
-                break;
-            }
-        }
-
-        if (day == 0) {
-            task.cell->displayValue = "N/A";
-            task.cell->queryExecuted = true;
-            task.cell->querySuccess = false;
-            failCount++;
-            continue;
-        }
-
-        // 构造完整日期
-        QString fullDate = QString("%1-%2").arg(m_baseYearMonth).arg(day, 2, 10, QChar('0'));
-
-        // 验证日期有效性
-        QDate date = QDate::fromString(fullDate, "yyyy-MM-dd");
-        if (!date.isValid()) {
-            // 无效日期（如2月30日）
-            task.cell->displayValue = "N/A";
-            task.cell->queryExecuted = true;
-            task.cell->querySuccess = false;
-            failCount++;
-            continue;
-        }
-
-        // 构造时间戳
-        QDateTime dateTime = constructDateTime(fullDate, m_baseTime);
-        int64_t timestamp = dateTime.toMSecsSinceEpoch();
-
-        float value = 0.0f;
-        // ===== 直接从缓存查找，不再检查 cacheReady =====
-        if (findInCache(task.cell->rtuId, timestamp, value)) {
-            task.cell->displayValue = QString::number(value, 'f', 2);  // 使用 displayValue
-            task.cell->queryExecuted = true;
-            task.cell->querySuccess = true;
-            successCount++;
-        }
-        else {
-            task.cell->displayValue = "N/A";  // 使用 displayValue
-            task.cell->queryExecuted = true;
-            task.cell->querySuccess = false;
-            failCount++;
-        }
-
-        if (progress) {
-            progress->setValue(i + 1);
-        }
-        emit queryProgress(i + 1, m_queryTasks.size());
+    if (!fillTasksFromCache(progress, successCount, failCount)) {
+        return false;
     }
+    emit queryProgress(m_queryTasks.size(), m_queryTasks.size());
 
     qDebug() << QString("月报填充完成: 成功 %1, 失败 %2").arg(successCount).arg(failCount);
     emit queryCompleted(successCount, failCount);
@@ -497,51 +441,62 @@ void MonthReportParser::collectActualDays()
 
     qDebug() << "========== 开始收集实际日期 ==========";
 
-    for (int row = 0; row < m_model->rowCount(); ++row) {
-        for (int col = 0; col < m_model->columnCount(); ++col) {
-            CellData* cell = m_model->getCell(row, col);
-
-            // 检查 cellType 而不是 markerText
-            if (cell && cell->cellType == CellData::TimeMarker) {
-                QString dayMarker = cell->markerText;
-
-                // **安全检查**：如果 markerText 为空，尝试从 displayValue 读取
-                if (dayMarker.isEmpty()) {
-                    dayMarker = cell->displayValue.toString();
-                    qDebug() << QString("  警告：行%1列%2的TimeMarker没有markerText，使用displayValue: %3")
-                        .arg(row).arg(col).arg(dayMarker);
-                }
+    const int totalCols = m_model->columnCount();
+    const QVector<QPair<int, int>> partitions = partitionRows(m_model->rowCount());
 
-                if (dayMarker.isEmpty()) {
-                    qWarning() << QString("  跳过空标记: 行%1列%2").arg(row).arg(col);
-                    continue;
-                }
+    // 各分区收集到本地集合，结束后合并，避免加锁
+    QVector<QSet<int>> localDays(partitions.size());
+    QSet<int>* buckets = localDays.data();
+
+    runPartitions(partitions.size(), [this, &partitions, totalCols, buckets](int index) {
+        for (int row = partitions[index].first; row < partitions[index].second; ++row) {
+            for (int col = 0; col < totalCols; ++col) {
+                const CellData* cell = m_model->getCell(row, col);
+
+                // 检查 cellType 而不是 markerText
+                if (cell && cell->cellType == CellData::TimeMarker) {
+                    QString dayMarker = cell->markerText;
+
+                    // **安全检查**：如果 markerText 为空，尝试从 displayValue 读取
+                    if (dayMarker.isEmpty()) {
+                        dayMarker = cell->displayValue.toString();
+                        qDebug() << QString("  警告：行%1列%2的TimeMarker没有markerText，使用displayValue: %3")
+                            .arg(row).arg(col).arg(dayMarker);
+                    }
+
+                    if (dayMarker.isEmpty()) {
+                        qWarning() << QString("  跳过空标记: 行%1列%2").arg(row).arg(col);
+                        continue;
+                    }
 
-                int day = extractDay(dayMarker);
+                    int day = extractDay(dayMarker);
 
-                if (day > 0) {
-                    QString fullDate = QString("%1-%2")
-                        .arg(m_baseYearMonth)
-                        .arg(day, 2, 10, QChar('0'));
+                    if (day > 0) {
+                        QString fullDate = QString("%1-%2")
+                            .arg(m_baseYearMonth)
+                            .arg(day, 2, 10, QChar('0'));
 
-                    QDate date = QDate::fromString(fullDate, "yyyy-MM-dd");
+                        QDate date = QDate::fromString(fullDate, "yyyy-MM-dd");
 
-                    if (date.isValid()) {
-                        m_actualDays.insert(day);
-                        qDebug() << QString("  收集日期: 行%1列%2, day=%3, fullDate=%4")
-                            .arg(row).arg(col).arg(day).arg(fullDate);
+                        if (date.isValid()) {
+                            buckets[index].insert(day);
+                        }
+                        else {
+                            qWarning() << QString("  无效日期: %1 (行%2列%3)")
+                                .arg(fullDate).arg(row).arg(col);
+                        }
                     }
                     else {
-                        qWarning() << QString("  无效日期: %1 (行%2列%3)")
-                            .arg(fullDate).arg(row).arg(col);
+                        qWarning() << QString("  无法解析日期数字: %1 (行%2列%3)")
+                            .arg(dayMarker).arg(row).arg(col);
                     }
                 }
-                else {
-                    qWarning() << QString("  无法解析日期数字: %1 (行%2列%3)")
-                        .arg(dayMarker).arg(row).arg(col);
-                }
             }
         }
+    });
+
+    for (const QSet<int>& days : localDays) {
+        m_actualDays.unite(days);
     }
 
     QList<int> sortedDays = m_actualDays.values();
@@ -614,18 +569,6 @@ QList<BaseReportParser::TimeBlock> MonthReportParser::identifyTimeBlocks()
     return blocks;
 }
 
-// 实现日期范围获取
-bool MonthReportParser::getDateRange(QString& startDate, QString& endDate)
-{
-    if (m_currentQueryStartDate.isEmpty() || m_currentQueryEndDate.isEmpty()) {
-        return false;
-    }
-
-    startDate = m_currentQueryStartDate;
-    endDate = m_currentQueryEndDate;
-    return true;
-}
-
 void MonthReportParser::onRescanCompleted(int newCount, int modifiedCount, int removedCount, 
                                          const QSet<int>& affectedRows)
 {
@@ -646,118 +589,132 @@ void MonthReportParser::onRescanCompleted(int newCount, int modifiedCount, int r
     }
 }
 
-bool MonthReportParser::analyzeAndPrefetch()
+BaseReportParser::PrefetchPlanPtr MonthReportParser::buildPrefetchPlan()
 {
+    std::shared_ptr<PrefetchPlan> plan = std::make_shared<PrefetchPlan>();
+
     qDebug() << "========== 月报预查询：重新收集日期 ==========";
     collectActualDays();
 
     // 1. 识别时间块
     QList<TimeBlock> blocks = identifyTimeBlocks();
 
-    // 使用基类中定义的 m_cancelRequested
+    // 2. 收集所有唯一的RTU
+    QSet<int> uniqueRTUs;
+    for (const QueryTask& task : m_queryTasks) {
+        if (task.rtuKey >= 0) {
+            uniqueRTUs.insert(task.rtuKey);
+        }
+    }
+    plan->rtuKeys = uniqueRTUs.values().toVector();
+    std::sort(plan->rtuKeys.begin(), plan->rtuKeys.end());
+    for (int rtuKey : plan->rtuKeys) {
+        plan->rtuNames.append(RtuDictionary::instance().name(rtuKey));
+    }
+    plan->intervalSeconds = getQueryIntervalSeconds();
+
+    // 3. 汇总所有日期的目标时间点，批量读取
+    plan->timestamps.reserve(blocks.size());
+    for (const TimeBlock& block : blocks) {
+        QDateTime dateTime(QDate::fromString(block.startDate, "yyyy-MM-dd"), block.startTime);
+        if (dateTime.isValid()) {
+            plan->timestamps.push_back(dateTime.toMSecsSinceEpoch());
+        }
+    }
+
+    if (!blocks.isEmpty()) {
+        qDebug() << QString("查询计划：%1 个RTU，%2 个日期（%3 ~ %4）")
+            .arg(plan->rtuKeys.size())
+            .arg(plan->timestamps.size())
+            .arg(blocks.first().startDate)
+            .arg(blocks.last().startDate);
+    }
+
+    return plan;
+}
+
+bool MonthReportParser::analyzeAndPrefetch(const PrefetchPlan& plan)
+{
     if (m_cancelRequested.loadAcquire()) {
         m_lastPrefetchSuccessCount = 0;
         m_lastPrefetchTotalCount = 0;
         return false;
     }
 
-    if (blocks.isEmpty()) {
+    if (plan.timestamps.empty()) {
         qWarning() << "未识别到有效时间块";
         m_lastPrefetchSuccessCount = 0;
         m_lastPrefetchTotalCount = 0;
         return false;
     }
 
-    // 2. 收集所有唯一的RTU
-    QSet<QString> uniqueRTUs;
-    for (const QueryTask& task : m_queryTasks) {
-        uniqueRTUs.insert(task.cell->rtuId);
+    std::vector<std::string> ycnoList;
+    ycnoList.reserve(plan.rtuNames.size());
+    for (const QString& name : plan.rtuNames) {
+        ycnoList.push_back(name.toStdString());
     }
-    QString rtuList = uniqueRTUs.values().join(",");
 
-    // 4. 执行查询
-    int successCount = 0;
-    int failCount = 0;
-    int intervalSeconds = getQueryIntervalSeconds();
+    // 每个日期一个读取窗口，统计与进度按日期计
+    const int totalCount = (int)plan.timestamps.size();
+    emit taskProgress(0, totalCount);
+
+    // 每个日期读取基准时刻起一分钟的窗口，与原逐日查询一致
+    const int64_t toleranceMs = (int64_t)plan.intervalSeconds * 1000;
+    TaosDataFetcher::TimestampFetchStats stats;
+
+    try {
+        TaosColumnarData data = m_fetcher->fetchAtTimestamps(ycnoList, plan.timestamps, toleranceMs, &stats,
+            [this]() { return m_cancelRequested.loadAcquire() != 0; },
+            [this](int finished, int total) { emit taskProgress(finished, total); });
 
-    for (int i = 0; i < blocks.size(); ++i) {
-        // 使用基类中定义的 m_cancelRequested
         if (m_cancelRequested.loadAcquire()) {
-            qDebug() << "后台查询被中断";
-            m_lastPrefetchSuccessCount = successCount;
-            m_lastPrefetchTotalCount = blocks.size();
+            qDebug() << QString("后台查询被中断：%1 个日期未查询").arg(stats.skipped);
+            m_lastPrefetchSuccessCount = stats.succeeded;
+            m_lastPrefetchTotalCount = stats.windowCount;
             return false;
         }
 
-        const TimeBlock& block = blocks[i];
-
-        qDebug() << QString("执行查询 %1/%2: %3 %4")
-            .arg(i + 1)
-            .arg(blocks.size())
-            .arg(block.startDate)
-            .arg(block.startTime.toString("HH:mm"));
-
-        // 使用基类中定义的统一进度信号 taskProgress
-        emit taskProgress(i + 1, blocks.size());
-
-        // 在每次查询前，更新当前查询的日期范围
-        m_currentQueryStartDate = block.startDate;
-        m_currentQueryEndDate = block.endDate;
-
-        bool success = executeSingleQuery(rtuList,
-            block.startTime,
-            block.endTime,
-            intervalSeconds);
-
-        if (success) {
-            successCount++;
+        if (data.empty()) {
+            qWarning() << "  查询无数据";
+            emit databaseError("未获取到有效数据，请检查TDengine连接");
         }
         else {
-            qWarning() << QString("查询失败: %1").arg(block.startDate);
-            failCount++;
+            mergeIntoCache(plan.rtuKeys, data);
         }
     }
+    catch (const std::exception& e) {
+        qWarning() << "  查询失败：" << e.what();
+        emit databaseError(QString("数据查询失败: %1").arg(e.what()));
+    }
 
-    m_lastPrefetchSuccessCount = successCount;
-    m_lastPrefetchTotalCount = blocks.size();
+    qDebug() << QString("预查询完成: 成功 %1/%2（无数据 %3，失败 %4）")
+        .arg(stats.succeeded).arg(stats.windowCount).arg(stats.empty).arg(stats.failed);
+    m_lastPrefetchSuccessCount = stats.succeeded;
+    m_lastPrefetchTotalCount = stats.windowCount;
 
-    // 只要有一次成功，就认为预查询有效
-    return successCount > 0;
+    // 只要有一个日期成功就认为预查询有效
+    return stats.succeeded > 0;
 }
 
 QString MonthReportParser::findTimeForDataMarker(int row, int col)
 {
-    for (int c = col - 1; c >= 0; --c) {
-        CellData* cell = m_model->getCell(row, c);
-        if (!cell) continue;
-
-        // 方法1：检查 cellType
-        if (cell->cellType == CellData::TimeMarker) {
-            // ===== 从 markerText 提取 =====
-            QString markerText = cell->markerText.isEmpty() ?
-                cell->displayValue.toString() :
-                cell->markerText;
-
-            int day = extractDay(markerText);  // ← 使用 extractDay 提取
-            if (day > 0) {
-                return QString::number(day);
-            }
-        }
+    QString dayStr;
+    if (!lookupTimeMarker(row, col, dayStr)) {
+        qWarning() << QString("数据标记[%1,%2]左侧未找到日期标记").arg(row).arg(col);
+    }
+    return dayStr;
+}
 
-        // 方法2：检查文本内容
-        QString text = cell->displayText().trimmed();
-        if (isTimeMarker(text)) {
-            int day = extractDay(text);
-            if (day > 0) {
-                qDebug() << QString("通过文本识别日期标记：行%1列%2，文本=%3，日期=%4")
-                    .arg(row).arg(c).arg(text).arg(day);
-                return QString::number(day);
-            }
-        }
+bool MonthReportParser::resolveTimeMarker(const QString& markerText, QString& value) const
+{
+    // 月报中 #t# 表示日；无效的日在查找时被跳过
+    int day = extractDay(markerText);
+    if (day <= 0) {
+        return false;
     }
 
-    qWarning() << QString("数据标记[%1,%2]左侧未找到日期标记").arg(row).arg(col);
-    return QString();
+    value = QString::number(day);
+    return true;
 }
 
 void MonthReportParser::validateActualDays()
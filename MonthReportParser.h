@@ -35,20 +35,22 @@ public:
 protected:
     // ===== 实现纯虚函数 =====
     bool findDateMarker() override;
-    void parseRow(int row) override;
+    void parseRow(int row, const RowScan& scan) override;
     QTime getTaskTime(const QueryTask& task) override;
+    int64_t resolveTaskTimestamp(const QueryTask& task) const override;
     QDateTime constructDateTime(const QString& date, const QString& time) override;
     int getQueryIntervalSeconds() const override { return 60; }  // 月报间隔24小时
 
     QList<TimeBlock> identifyTimeBlocks() override;
-    bool getDateRange(QString& startDate, QString& endDate) override;
 
     // ==== = 重写预查询逻辑 ==== =
-    bool analyzeAndPrefetch() override;
+    bool analyzeAndPrefetch(const PrefetchPlan& plan) override;
 
-    bool runAsyncTask() override;
+    PrefetchPlanPtr buildPrefetchPlan() override;
+    bool runAsyncTask(const PrefetchPlanPtr& plan) override;
 
     QString findTimeForDataMarker(int row, int col) override;
+    bool resolveTimeMarker(const QString& markerText, QString& value) const override;
 
     void  onRescanCompleted(int newCount, int modifiedCount, int removedCount,
         const QSet<int>& affectedRows)  override;
@@ -87,10 +89,6 @@ private:
     QString m_baseTime;        // "08:30:00"
 
     QSet<int> m_actualDays; // 实际出现的日期集合：{ 10, 11, 12, ..., 20 }
-
-    // 临时存储当前查询的日期范围（用于 getDateRange）
-    QString m_currentQueryStartDate;
-    QString m_currentQueryEndDate;
 };
 
 #endif // MONTHREPORTPARSER_H
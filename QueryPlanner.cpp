@@ -0,0 +1,258 @@
+#include "QueryPlanner.h"
+
+#include <QSettings>
+#include <QMutexLocker>
+#include <QStringList>
+#include <qDebug>
+#include <cmath>
+
+namespace {
+    // 未校准时的默认参数
+    const double DEFAULT_LATENCY_MS = 200.0;
+    const double DEFAULT_PER_VALUE_MS = 0.002;
+
+    // 参数下限，防止异常观测导致退化（如延迟为0时永不合并）
+    const double MIN_LATENCY_MS = 1.0;
+    const double MIN_PER_VALUE_MS = 1e-6;
+
+    // 观测衰减系数：越接近1，历史观测的权重越大
+    const double OBSERVATION_DECAY = 0.9;
+
+    // 旧配置只有模型参数时，按该权重的虚拟观测恢复累加量
+    const double SEED_WEIGHT = 5.0;
+    const double SEED_VALUES = 10000.0;
+}
+
+QueryPlanner& QueryPlanner::instance()
+{
+    static QueryPlanner planner;
+    return planner;
+}
+
+QueryPlanner::QueryPlanner()
+    : m_model({ DEFAULT_LATENCY_MS, DEFAULT_PER_VALUE_MS, 0 })
+    , m_sumWeight(0.0)
+    , m_sumX(0.0)
+    , m_sumY(0.0)
+    , m_sumXX(0.0)
+    , m_sumXY(0.0)
+{
+    load();
+}
+
+qint64 QueryPlanner::rowsForSpan(qint64 spanSeconds, int intervalSeconds)
+{
+    if (intervalSeconds <= 0) {
+        return 1;
+    }
+    return qMax<qint64>(0, spanSeconds) / intervalSeconds + 1;
+}
+
+double QueryPlanner::estimateCost(const CostModel& model, qint64 rows, int rtuCount)
+{
+    return model.latencyMs + (double)rows * qMax(1, rtuCount) * model.perValueMs;
+}
+
+QueryPlanner::Plan QueryPlanner::plan(const QList<QPair<QTime, int>>& sortedPoints,
+    int rtuCount,
+    int intervalSeconds,
+    int tailSeconds)
+{
+    Plan result;
+    result.rtuCount = qMax(1, rtuCount);
+    result.intervalSeconds = intervalSeconds;
+    result.model = model();
+
+    if (sortedPoints.isEmpty()) {
+        return result;
+    }
+
+    // 合并条件：延伸当前查询覆盖下一个时间点的代价 <= 当前查询与单独查询该时间点的代价之和
+    // 两者之差基本只取决于空档长度，各空档的决策近似互不影响，因此从左到右贪心合并
+    const CostModel& costModel = result.model;
+    const int rtus = result.rtuCount;
+
+    PlannedQuery current;
+    current.startTime = sortedPoints[0].first;
+    current.endTime = sortedPoints[0].first;
+    current.taskIndices.append(sortedPoints[0].second);
+
+    for (int i = 1; i < sortedPoints.size(); ++i) {
+        const QTime& time = sortedPoints[i].first;
+        const double mergedCost = estimateCost(costModel,
+            rowsForSpan(current.startTime.secsTo(time) + tailSeconds, intervalSeconds), rtus);
+        const double splitCost =
+            estimateCost(costModel, rowsForSpan(current.startTime.secsTo(current.endTime) + tailSeconds, intervalSeconds), rtus) +
+            estimateCost(costModel, rowsForSpan(tailSeconds, intervalSeconds), rtus);
+
+        if (mergedCost <= splitCost) {
+            current.endTime = time;
+            current.taskIndices.append(sortedPoints[i].second);
+        }
+        else {
+            result.queries.append(current);
+            current = PlannedQuery();
+            current.startTime = time;
+            current.endTime = time;
+            current.taskIndices.append(sortedPoints[i].second);
+        }
+    }
+    result.queries.append(current);
+
+    for (PlannedQuery& query : result.queries) {
+        query.rows = rowsForSpan(query.startTime.secsTo(query.endTime) + tailSeconds, intervalSeconds);
+        query.estimatedCostMs = estimateCost(costModel, query.rows, rtus);
+        result.totalCostMs += query.estimatedCostMs;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_lastPlan = result;
+    }
+
+    return result;
+}
+
+void QueryPlanner::recordObservation(qint64 rows, int rtuCount, double elapsedMs)
+{
+    if (rows <= 0 || elapsedMs < 0.0) {
+        return;
+    }
+
+    const double x = (double)rows * qMax(1, rtuCount);
+    const double y = elapsedMs;
+
+    QMutexLocker locker(&m_mutex);
+    m_sumWeight = m_sumWeight * OBSERVATION_DECAY + 1.0;
+    m_sumX = m_sumX * OBSERVATION_DECAY + x;
+    m_sumY = m_sumY * OBSERVATION_DECAY + y;
+    m_sumXX = m_sumXX * OBSERVATION_DECAY + x * x;
+    m_sumXY = m_sumXY * OBSERVATION_DECAY + x * y;
+    m_model.observations++;
+
+    refit();
+}
+
+void QueryPlanner::refit()
+{
+    // 调用方已持有 m_mutex
+    if (m_sumWeight <= 0.0) {
+        return;
+    }
+
+    const double meanX = m_sumX / m_sumWeight;
+    const double meanY = m_sumY / m_sumWeight;
+    const double varX = m_sumXX / m_sumWeight - meanX * meanX;
+
+    double perValue = m_model.perValueMs;
+    // 观测规模差异足够大时才重新估计斜率，否则只修正截距
+    if (varX > 1e-6 * meanX * meanX && varX > 0.0) {
+        const double covXY = m_sumXY / m_sumWeight - meanX * meanY;
+        perValue = covXY / varX;
+    }
+
+    perValue = qMax(MIN_PER_VALUE_MS, perValue);
+    double latency = qMax(MIN_LATENCY_MS, meanY - perValue * meanX);
+
+    if (std::isfinite(perValue) && std::isfinite(latency)) {
+        m_model.perValueMs = perValue;
+        m_model.latencyMs = latency;
+    }
+}
+
+void QueryPlanner::load()
+{
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ScadaReportControl", "QueryPlanner");
+    settings.beginGroup("CostModel");
+    m_model.latencyMs = qMax(MIN_LATENCY_MS, settings.value("latencyMs", DEFAULT_LATENCY_MS).toDouble());
+    m_model.perValueMs = qMax(MIN_PER_VALUE_MS, settings.value("perValueMs", DEFAULT_PER_VALUE_MS).toDouble());
+    m_model.observations = settings.value("observations", 0).toInt();
+
+    // 恢复衰减累加量，使后续观测在已有校准的基础上继续拟合，而不是由单次观测重新确定
+    if (settings.contains("sumWeight")) {
+        m_sumWeight = settings.value("sumWeight", 0.0).toDouble();
+        m_sumX = settings.value("sumX", 0.0).toDouble();
+        m_sumY = settings.value("sumY", 0.0).toDouble();
+        m_sumXX = settings.value("sumXX", 0.0).toDouble();
+        m_sumXY = settings.value("sumXY", 0.0).toDouble();
+    }
+    else if (m_model.observations > 0) {
+        const double y = m_model.latencyMs + m_model.perValueMs * SEED_VALUES;
+        m_sumWeight = SEED_WEIGHT;
+        m_sumX = SEED_WEIGHT * SEED_VALUES;
+        m_sumY = SEED_WEIGHT * y;
+        m_sumXX = SEED_WEIGHT * SEED_VALUES * SEED_VALUES;
+        m_sumXY = SEED_WEIGHT * SEED_VALUES * y;
+    }
+    settings.endGroup();
+
+    qDebug() << QString("查询规划器：往返延迟 %1 ms，单值代价 %2 ms（%3 次观测）")
+        .arg(m_model.latencyMs, 0, 'f', 1)
+        .arg(m_model.perValueMs, 0, 'g', 4)
+        .arg(m_model.observations);
+}
+
+void QueryPlanner::save()
+{
+    CostModel current;
+    double sums[5];
+    {
+        QMutexLocker locker(&m_mutex);
+        current = m_model;
+        sums[0] = m_sumWeight;
+        sums[1] = m_sumX;
+        sums[2] = m_sumY;
+        sums[3] = m_sumXX;
+        sums[4] = m_sumXY;
+    }
+
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ScadaReportControl", "QueryPlanner");
+    settings.beginGroup("CostModel");
+    settings.setValue("latencyMs", current.latencyMs);
+    settings.setValue("perValueMs", current.perValueMs);
+    settings.setValue("observations", current.observations);
+    settings.setValue("sumWeight", sums[0]);
+    settings.setValue("sumX", sums[1]);
+    settings.setValue("sumY", sums[2]);
+    settings.setValue("sumXX", sums[3]);
+    settings.setValue("sumXY", sums[4]);
+    settings.endGroup();
+}
+
+QueryPlanner::CostModel QueryPlanner::model() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_model;
+}
+
+QueryPlanner::Plan QueryPlanner::lastPlan() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_lastPlan;
+}
+
+QString QueryPlanner::Plan::describe() const
+{
+    QStringList lines;
+    lines << QString("查询计划：%1 次查询，%2 个RTU，间隔 %3 秒，预计总代价 %4 ms")
+        .arg(queries.size())
+        .arg(rtuCount)
+        .arg(intervalSeconds)
+        .arg(totalCostMs, 0, 'f', 1);
+    lines << QString("  模型：往返延迟 %1 ms，单值代价 %2 ms")
+        .arg(model.latencyMs, 0, 'f', 1)
+        .arg(model.perValueMs, 0, 'g', 4);
+
+    for (int i = 0; i < queries.size(); ++i) {
+        const PlannedQuery& query = queries[i];
+        lines << QString("  [%1] %2 ~ %3，%4 个任务，约 %5 行，预计 %6 ms")
+            .arg(i + 1)
+            .arg(query.startTime.toString("HH:mm:ss"))
+            .arg(query.endTime.toString("HH:mm:ss"))
+            .arg(query.taskIndices.size())
+            .arg(query.rows)
+            .arg(query.estimatedCostMs, 0, 'f', 1);
+    }
+
+    return lines.join("\n");
+}
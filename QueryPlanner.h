@@ -0,0 +1,100 @@
+#pragma once
+#ifndef QUERYPLANNER_H
+#define QUERYPLANNER_H
+
+#include <QList>
+#include <QPair>
+#include <QTime>
+#include <QString>
+#include <QMutex>
+
+/**
+ * @brief 基于代价模型的查询规划器
+ * 单次查询代价 = 往返延迟 + 返回行数 × RTU数 × 单值传输代价。
+ * 相邻时间点之间的空档是否并入同一查询，取决于多传输空档数据的代价是否低于多一次往返的延迟。
+ * 模型参数根据实际查询耗时在线校准，并通过 QSettings 在多次运行之间保存。
+ */
+class QueryPlanner
+{
+public:
+    // 代价模型参数
+    struct CostModel {
+        double latencyMs;       // 单次查询往返延迟（毫秒）
+        double perValueMs;      // 单个数值的传输与解析代价（毫秒）
+        int observations;       // 已用于校准的观测次数
+    };
+
+    // 规划出的单次查询
+    struct PlannedQuery {
+        QTime startTime;
+        QTime endTime;
+        QList<int> taskIndices;     // 覆盖的任务索引
+        qint64 rows;                // 预计返回行数
+        double estimatedCostMs;     // 预计代价
+    };
+
+    // 查询计划（可供检查）
+    struct Plan {
+        QList<PlannedQuery> queries;
+        int rtuCount = 0;
+        int intervalSeconds = 0;
+        double totalCostMs = 0.0;
+        CostModel model = { 0.0, 0.0, 0 };
+
+        QString describe() const;
+    };
+
+    static QueryPlanner& instance();
+
+    /**
+     * @brief 为一组按时间升序排列的时间点规划查询
+     * @param sortedPoints (时间, 任务索引) 列表，按时间升序
+     * @param rtuCount 每次查询包含的RTU数
+     * @param intervalSeconds 采样间隔
+     * @param tailSeconds 每次查询在终点之后额外读取的秒数
+     */
+    Plan plan(const QList<QPair<QTime, int>>& sortedPoints,
+        int rtuCount,
+        int intervalSeconds,
+        int tailSeconds);
+
+    // 按给定模型估算单次查询代价（规划时使用同一份模型快照）
+    static double estimateCost(const CostModel& model, qint64 rows, int rtuCount);
+
+    /**
+     * @brief 记录一次实际查询的观测值，用于校准模型（线程安全）
+     * @param rows 返回行数
+     * @param rtuCount RTU数
+     * @param elapsedMs 实际耗时
+     */
+    void recordObservation(qint64 rows, int rtuCount, double elapsedMs);
+
+    // 将模型参数与拟合累加量写入 QSettings
+    void save();
+
+    CostModel model() const;
+    Plan lastPlan() const;
+
+private:
+    QueryPlanner();
+    QueryPlanner(const QueryPlanner&) = delete;
+    QueryPlanner& operator=(const QueryPlanner&) = delete;
+
+    void load();
+    void refit();
+
+    static qint64 rowsForSpan(qint64 spanSeconds, int intervalSeconds);
+
+    mutable QMutex m_mutex;
+    CostModel m_model;
+    Plan m_lastPlan;
+
+    // 指数衰减的最小二乘累加量：耗时 = 延迟 + 单值代价 × 数值个数
+    double m_sumWeight;
+    double m_sumX;
+    double m_sumY;
+    double m_sumXX;
+    double m_sumXY;
+};
+
+#endif // QUERYPLANNER_H
@@ -0,0 +1,203 @@
+#include "RangeAggregateIndex.h"
+
+#include <limits>
+
+RangeAggregateIndex::Aggregate::Aggregate()
+    : minValue(std::numeric_limits<double>::infinity())
+    , maxValue(-std::numeric_limits<double>::infinity())
+    , count(0)
+{
+}
+
+void RangeAggregateIndex::Aggregate::merge(const Aggregate& other)
+{
+    if (other.count == 0) {
+        return;
+    }
+    if (other.minValue < minValue) minValue = other.minValue;
+    if (other.maxValue > maxValue) maxValue = other.maxValue;
+    count += other.count;
+}
+
+RangeAggregateIndex::Aggregate RangeAggregateIndex::leaf(const CellValue& value)
+{
+    Aggregate result;
+    if (value.isNumber()) {
+        result.minValue = value.number;
+        result.maxValue = value.number;
+        result.count = 1;
+    }
+    return result;
+}
+
+RangeAggregateIndex::SegmentMap::const_iterator RangeAggregateIndex::findSegment(
+    const SegmentMap& segments, int row)
+{
+    // 段首行不大于 row 的最后一段
+    auto it = segments.upperBound(row);
+    if (it == segments.constBegin()) {
+        return segments.constEnd();
+    }
+    --it;
+    return row < it.key() + it->size ? it : segments.constEnd();
+}
+
+void RangeAggregateIndex::buildSegment(int col, int firstRow, const QVector<CellValue>& values)
+{
+    if (values.isEmpty()) {
+        return;
+    }
+    SegmentMap& segments = m_columns[col];
+
+    // 移除与新段重叠的旧段
+    const int lastRow = firstRow + values.size() - 1;
+    auto it = segments.upperBound(firstRow);
+    if (it != segments.begin()) {
+        --it;
+    }
+    while (it != segments.end() && it.key() <= lastRow) {
+        if (it.key() + it->size > firstRow) {
+            it = segments.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    Segment segment;
+    segment.size = values.size();
+    segment.tree.resize(2 * segment.size);
+
+    for (int i = 0; i < segment.size; ++i) {
+        segment.tree[segment.size + i] = leaf(values[i]);
+    }
+    for (int i = segment.size - 1; i > 0; --i) {
+        Aggregate node = segment.tree[2 * i];
+        node.merge(segment.tree[2 * i + 1]);
+        segment.tree[i] = node;
+    }
+
+    segments.insert(firstRow, segment);
+}
+
+bool RangeAggregateIndex::covers(int col, int firstRow, int lastRow) const
+{
+    auto colIt = m_columns.constFind(col);
+    if (colIt == m_columns.constEnd()) {
+        return false;
+    }
+    auto it = findSegment(colIt.value(), firstRow);
+    return it != colIt->constEnd() && lastRow < it.key() + it->size;
+}
+
+void RangeAggregateIndex::expandToSegments(int col, int& firstRow, int& lastRow) const
+{
+    auto colIt = m_columns.constFind(col);
+    if (colIt == m_columns.constEnd()) {
+        return;
+    }
+
+    // 各段互不重叠，按首行顺序一次扫描即可
+    const SegmentMap& segments = colIt.value();
+    auto it = segments.upperBound(firstRow);
+    if (it != segments.constBegin()) {
+        --it;
+    }
+    for (; it != segments.constEnd() && it.key() <= lastRow; ++it) {
+        const int segmentLast = it.key() + it->size - 1;
+        if (segmentLast >= firstRow) {
+            firstRow = qMin(firstRow, it.key());
+            lastRow = qMax(lastRow, segmentLast);
+        }
+    }
+}
+
+void RangeAggregateIndex::update(int row, int col, const CellValue& value)
+{
+    auto colIt = m_columns.find(col);
+    if (colIt == m_columns.end()) {
+        return;
+    }
+
+    SegmentMap& segments = colIt.value();
+    auto found = findSegment(segments, row);
+    if (found == segments.constEnd()) {
+        return;
+    }
+
+    Segment& segment = segments[found.key()];
+    QVector<Aggregate>& tree = segment.tree;
+    int i = segment.size + (row - found.key());
+    tree[i] = leaf(value);
+    for (i /= 2; i > 0; i /= 2) {
+        Aggregate node = tree[2 * i];
+        node.merge(tree[2 * i + 1]);
+        tree[i] = node;
+    }
+}
+
+bool RangeAggregateIndex::query(const QPoint& start, const QPoint& end, Aggregate& result) const
+{
+    result = Aggregate();
+    if (end.x() < start.x() || end.y() < start.y()) {
+        return false;
+    }
+
+    for (int col = start.y(); col <= end.y(); ++col) {
+        auto colIt = m_columns.constFind(col);
+        if (colIt == m_columns.constEnd()) {
+            return false;
+        }
+        auto it = findSegment(colIt.value(), start.x());
+        if (it == colIt->constEnd() || end.x() >= it.key() + it->size) {
+            return false;
+        }
+
+        // 半开区间 [l, r) 自底向上合并
+        const QVector<Aggregate>& tree = it->tree;
+        const int base = it->size - it.key();
+        for (int l = start.x() + base, r = end.x() + 1 + base; l < r; l /= 2, r /= 2) {
+            if (l & 1) result.merge(tree[l++]);
+            if (r & 1) result.merge(tree[--r]);
+        }
+    }
+    return true;
+}
+
+bool RangeAggregateIndex::sum(const QPoint& start, const QPoint& end, double& result, int& count) const
+{
+    result = 0.0;
+    count = 0;
+    if (end.x() < start.x() || end.y() < start.y()) {
+        return false;
+    }
+
+    // 各列定位到覆盖该区域的索引段，leaves[i] 指向第 start.x() 行的叶子
+    QVector<const Aggregate*> leaves;
+    leaves.reserve(end.y() - start.y() + 1);
+    for (int col = start.y(); col <= end.y(); ++col) {
+        auto colIt = m_columns.constFind(col);
+        if (colIt == m_columns.constEnd()) {
+            return false;
+        }
+        auto it = findSegment(colIt.value(), start.x());
+        if (it == colIt->constEnd() || end.x() >= it.key() + it->size) {
+            return false;
+        }
+        leaves.append(it->tree.constData() + it->size + (start.x() - it.key()));
+    }
+
+    // 与 FormulaEngine 逐格计算相同的顺序和累加方式
+    const int rows = end.x() - start.x() + 1;
+    for (int r = 0; r < rows; ++r) {
+        for (const Aggregate* column : leaves) {
+            const Aggregate& node = column[r];
+            if (node.count == 0) {
+                continue;
+            }
+            result = count > 0 ? result + node.minValue : node.minValue;
+            ++count;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef RANGEAGGREGATEINDEX_H
+#define RANGEAGGREGATEINDEX_H
+
+#include "CellValue.h"
+
+#include <QHash>
+#include <QMap>
+#include <QPoint>
+#include <QVector>
+
+/**
+ * @brief 按列的区间聚合索引（SUM/MAX/MIN 加速）
+ * 每列可索引若干段互不重叠的连续行，每段一棵线段树，叶子为该行的数值（非数值单元格不计入），
+ * 内部节点保存区间的最小值、最大值与有效值个数。MAX/MIN 查询与单点更新均为 O(log n)，
+ * 单元格数值变化时可直接更新，不必整段重建（稀疏表查询 O(1) 但单点修改需重建）。
+ * SUM 不走树节点：按逐格计算的顺序（先行后列）累加叶子，结果与是否建索引无关。
+ * 坐标均为 (行, 列)，0基。
+ */
+class RangeAggregateIndex
+{
+public:
+    struct Aggregate {
+        double minValue;        // 叶子节点即该行的数值
+        double maxValue;
+        int count;          // 数值单元格个数
+
+        Aggregate();
+        void merge(const Aggregate& other);
+    };
+
+    /**
+     * @brief 为第 col 列的第 firstRow..firstRow+values.size()-1 行建立索引
+     * 该列与之重叠的已有索引段被替换
+     */
+    void buildSegment(int col, int firstRow, const QVector<CellValue>& values);
+
+    /**
+     * @brief 第 col 列的 [firstRow, lastRow] 是否落在同一索引段内
+     */
+    bool covers(int col, int firstRow, int lastRow) const;
+
+    /**
+     * @brief 将 [firstRow, lastRow] 扩展到包含与之重叠的已有索引段（重建时使用）
+     */
+    void expandToSegments(int col, int& firstRow, int& lastRow) const;
+
+    /**
+     * @brief 单元格数值变化时更新（该行未建索引时忽略）
+     */
+    void update(int row, int col, const CellValue& value);
+
+    /**
+     * @brief 区域 [start, end] 的最小值、最大值与有效值个数
+     * @return 区域内有列未被同一索引段完整覆盖时返回 false（调用方逐格计算）
+     */
+    bool query(const QPoint& start, const QPoint& end, Aggregate& result) const;
+
+    /**
+     * @brief 区域 [start, end] 的数值之和，按先行后列的顺序逐个累加
+     * 与逐格计算的加法顺序一致，浮点结果逐位相同
+     * @return 同 query
+     */
+    bool sum(const QPoint& start, const QPoint& end, double& result, int& count) const;
+
+    void clear() { m_columns.clear(); }
+    bool isEmpty() const { return m_columns.isEmpty(); }
+
+private:
+    struct Segment {
+        int size = 0;               // 叶子数（行数）
+        QVector<Aggregate> tree;    // 自底向上的线段树，叶子位于 [size, 2*size)
+    };
+    typedef QMap<int, Segment> SegmentMap;  // 段首行 -> 索引段
+
+    static Aggregate leaf(const CellValue& value);
+    static SegmentMap::const_iterator findSegment(const SegmentMap& segments, int row);
+
+    QHash<int, SegmentMap> m_columns;
+};
+
+#endif // RANGEAGGREGATEINDEX_H
@@ -0,0 +1,68 @@
+#include "RtuDictionary.h"
+
+RtuDictionary& RtuDictionary::instance()
+{
+    static RtuDictionary dictionary;
+    return dictionary;
+}
+
+int RtuDictionary::intern(const QString& rtuId)
+{
+    if (rtuId.isEmpty()) {
+        return -1;
+    }
+
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_keys.constFind(rtuId);
+        if (it != m_keys.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    // 双重检查：获取写锁期间可能已被其他线程登记
+    auto it = m_keys.constFind(rtuId);
+    if (it != m_keys.constEnd()) {
+        return it.value();
+    }
+
+    int rtuKey = m_names.size();
+    m_names.append(rtuId);
+    m_keys.insert(rtuId, rtuKey);
+    return rtuKey;
+}
+
+int RtuDictionary::find(const QString& rtuId) const
+{
+    QReadLocker locker(&m_lock);
+    return m_keys.value(rtuId, -1);
+}
+
+QString RtuDictionary::name(int rtuKey) const
+{
+    QReadLocker locker(&m_lock);
+    if (rtuKey < 0 || rtuKey >= m_names.size()) {
+        return QString();
+    }
+    return m_names[rtuKey];
+}
+
+QString RtuDictionary::joinNames(const QVector<int>& rtuKeys) const
+{
+    QReadLocker locker(&m_lock);
+    QStringList names;
+    names.reserve(rtuKeys.size());
+    for (int rtuKey : rtuKeys) {
+        if (rtuKey >= 0 && rtuKey < m_names.size()) {
+            names.append(m_names[rtuKey]);
+        }
+    }
+    return names.join(",");
+}
+
+int RtuDictionary::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_names.size();
+}
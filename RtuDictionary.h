@@ -0,0 +1,56 @@
+#pragma once
+#ifndef RTUDICTIONARY_H
+#define RTUDICTIONARY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QReadWriteLock>
+
+/**
+ * @brief 进程级RTU字典
+ * 将RTU号字符串映射为稠密的整型编号（从0开始递增），
+ * 解析阶段完成一次映射后，缓存、查询任务和对齐数据均以整型编号为键
+ */
+class RtuDictionary
+{
+public:
+    static RtuDictionary& instance();
+
+    /**
+     * @brief 获取RTU号对应的编号，不存在时分配新编号（线程安全）
+     * @param rtuId RTU号
+     * @return 编号，RTU号为空时返回 -1
+     */
+    int intern(const QString& rtuId);
+
+    /**
+     * @brief 查找RTU号对应的编号（不分配）
+     * @return 编号，未登记时返回 -1
+     */
+    int find(const QString& rtuId) const;
+
+    /**
+     * @brief 根据编号取回RTU号
+     */
+    QString name(int rtuKey) const;
+
+    /**
+     * @brief 将一组编号拼接为查询地址中的RTU列表（逗号分隔）
+     */
+    QString joinNames(const QVector<int>& rtuKeys) const;
+
+    int size() const;
+
+private:
+    RtuDictionary() = default;
+    RtuDictionary(const RtuDictionary&) = delete;
+    RtuDictionary& operator=(const RtuDictionary&) = delete;
+
+    mutable QReadWriteLock m_lock;
+    QHash<QString, int> m_keys;     // RTU号 -> 编号
+    QVector<QString> m_names;       // 编号 -> RTU号
+};
+
+#endif // RTUDICTIONARY_H
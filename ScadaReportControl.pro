@@ -51,6 +51,14 @@ SOURCES += \
     MonthReportParser.cpp\
 	TimeSettingsDialog.cpp\
 	UnifiedQueryParser.cpp\
+	RtuDictionary.cpp\
+	TaosConnectionPool.cpp\
+	QueryPlanner.cpp\
+	DataAligner.cpp\
+	TimeAxis.cpp\
+	UnifiedDisplayCache.cpp\
+	FormulaDependencyGraph.cpp\
+	RangeAggregateIndex.cpp\
 
 # ============ 头文件 ============
 HEADERS += \
@@ -66,6 +74,15 @@ HEADERS += \
     MonthReportParser.h\
 	TimeSettingsDialog.h\
 	UnifiedQueryParser.h\
+	RtuDictionary.h\
+	TaosConnectionPool.h\
+	QueryPlanner.h\
+	DataAligner.h\
+	TimeAxis.h\
+	UnifiedDisplayCache.h\
+	FormulaDependencyGraph.h\
+	CellValue.h\
+	RangeAggregateIndex.h\
 
 # ============ 资源文件 ============
 RESOURCES += ReportTable.qrc
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "TaosConnectionPool.h"
+#include "taosdbapi.h"
+
+#include <QMutexLocker>
+#include <qDebug>
+
+// ===== Lease 实现 =====
+
+TaosConnectionPool::Lease::Lease(Lease&& other)
+    : m_pool(other.m_pool)
+    , m_handle(other.m_handle)
+{
+    other.m_pool = nullptr;
+    other.m_handle = nullptr;
+}
+
+TaosConnectionPool::Lease& TaosConnectionPool::Lease::operator=(Lease&& other)
+{
+    if (this != &other) {
+        release();
+        m_pool = other.m_pool;
+        m_handle = other.m_handle;
+        other.m_pool = nullptr;
+        other.m_handle = nullptr;
+    }
+    return *this;
+}
+
+TaosConnectionPool::Lease::~Lease()
+{
+    release();
+}
+
+void TaosConnectionPool::Lease::release()
+{
+    if (m_pool && m_handle) {
+        m_pool->giveBack(m_handle);
+    }
+    m_pool = nullptr;
+    m_handle = nullptr;
+}
+
+// ===== TaosConnectionPool 实现 =====
+
+TaosConnectionPool& TaosConnectionPool::instance()
+{
+    static TaosConnectionPool pool;
+    return pool;
+}
+
+TaosConnectionPool::TaosConnectionPool()
+    : m_created(0)
+    , m_maxSize(4)
+{
+}
+
+TaosConnectionPool::~TaosConnectionPool()
+{
+    QMutexLocker locker(&m_mutex);
+    qDeleteAll(m_idle);
+    m_idle.clear();
+}
+
+void TaosConnectionPool::initialize(int maxSize, int warmCount)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxSize = qMax(1, maxSize);
+
+    int target = qMin(warmCount, m_maxSize);
+    while (m_created < target) {
+        m_idle.append(new taosdbapi());
+        m_created++;
+    }
+
+    qDebug() << QString("TDengine 连接池初始化：容量 %1，已预热 %2 个连接")
+        .arg(m_maxSize).arg(m_created);
+
+    // 容量扩大后唤醒等待者
+    m_available.wakeAll();
+}
+
+TaosConnectionPool::Lease TaosConnectionPool::acquire()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_idle.isEmpty() && m_created >= m_maxSize) {
+        m_available.wait(&m_mutex);
+    }
+
+    if (!m_idle.isEmpty()) {
+        return Lease(this, m_idle.takeLast());
+    }
+
+    // 未达上限，按需创建新句柄
+    m_created++;
+    locker.unlock();
+
+    taosdbapi* handle = nullptr;
+    try {
+        handle = new taosdbapi();
+    }
+    catch (...) {
+        QMutexLocker relock(&m_mutex);
+        m_created--;
+        m_available.wakeOne();
+        throw;
+    }
+
+    return Lease(this, handle);
+}
+
+void TaosConnectionPool::giveBack(taosdbapi* handle)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // 容量缩小后多余的句柄直接释放
+    if (m_created > m_maxSize) {
+        m_created--;
+        locker.unlock();
+        delete handle;
+        return;
+    }
+
+    m_idle.append(handle);
+    m_available.wakeOne();
+}
+
+int TaosConnectionPool::maxSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxSize;
+}
+
+int TaosConnectionPool::idleCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_idle.size();
+}
+
+int TaosConnectionPool::createdCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_created;
+}
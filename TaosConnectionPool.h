@@ -0,0 +1,80 @@
+#pragma once
+#ifndef TAOSCONNECTIONPOOL_H
+#define TAOSCONNECTIONPOOL_H
+
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+
+class taosdbapi;
+
+/**
+ * @brief 进程级 taosdbapi 连接池
+ * 所有解析器与查询线程共享，借出/归还语义，线程安全。
+ * 句柄按需创建，总数不超过 maxSize；池满时借出方阻塞等待归还。
+ */
+class TaosConnectionPool
+{
+public:
+    /**
+     * @brief 连接租约（RAII）
+     * 析构时自动将句柄归还连接池，只能移动不能复制
+     */
+    class Lease
+    {
+    public:
+        Lease() : m_pool(nullptr), m_handle(nullptr) {}
+        Lease(Lease&& other);
+        Lease& operator=(Lease&& other);
+        ~Lease();
+
+        taosdbapi* get() const { return m_handle; }
+        taosdbapi* operator->() const { return m_handle; }
+        bool isValid() const { return m_handle != nullptr; }
+
+    private:
+        friend class TaosConnectionPool;
+        Lease(TaosConnectionPool* pool, taosdbapi* handle) : m_pool(pool), m_handle(handle) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        void release();
+
+        TaosConnectionPool* m_pool;
+        taosdbapi* m_handle;
+    };
+
+    static TaosConnectionPool& instance();
+
+    /**
+     * @brief 设置连接池容量并预热连接
+     * @param maxSize 最大句柄数（至少为1）
+     * @param warmCount 启动时预先创建的句柄数（不超过 maxSize）
+     */
+    void initialize(int maxSize, int warmCount);
+
+    /**
+     * @brief 借出一个句柄，池中无空闲且已达上限时阻塞等待
+     */
+    Lease acquire();
+
+    int maxSize() const;
+    int idleCount() const;
+    int createdCount() const;
+
+private:
+    TaosConnectionPool();
+    ~TaosConnectionPool();
+    TaosConnectionPool(const TaosConnectionPool&) = delete;
+    TaosConnectionPool& operator=(const TaosConnectionPool&) = delete;
+
+    void giveBack(taosdbapi* handle);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_available;
+    QList<taosdbapi*> m_idle;       // 空闲句柄
+    int m_created;                  // 已创建句柄总数（含借出中的）
+    int m_maxSize;
+};
+
+#endif // TAOSCONNECTIONPOOL_H
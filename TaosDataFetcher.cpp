@@ -1,23 +1,30 @@
 #include "TaosDataFetcher.h"
+#include "TaosConnectionPool.h"
 #include <sstream>
 #include <iomanip>
 #include <ctime>
 #include <iostream>
 #include <algorithm>
+#include <limits>
 #include <QMessageBox>
 #include <qDebug>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QAtomicInt>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 TaosDataFetcher::TaosDataFetcher()
-    : tdb(new taosdbapi())
+    : m_streamChunkRows(10000)
 {
 }
 
 TaosDataFetcher::~TaosDataFetcher()
 {
-    delete tdb;
 }
 
-std::map<int64_t, std::vector<float>> TaosDataFetcher::fetchDataFromAddress(const std::string& address)
+TaosColumnarData TaosDataFetcher::fetchDataFromAddress(const std::string& address)
 {
     std::vector<std::string> ycnoList;
     std::string startTime;
@@ -32,30 +39,243 @@ std::map<int64_t, std::vector<float>> TaosDataFetcher::fetchDataFromAddress(cons
         throw std::runtime_error("地址中未包含有效的YCNO编号");
     }
 
+    TaosColumnarData result = readColumnar(ycnoList, startTime, endTime, interval);
+    if (result.empty())
+    {
+        //QMessageBox::warning(NULL, "警告", "未获取到有效数据，请检查taos连接", QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+        qWarning() << "未获取到有效数据，请检查taos连接";
+    }
+    return result;
+}
+
+bool TaosDataFetcher::fetchStreaming(const std::string& address, const ChunkConsumer& consumer,
+    double* readElapsedMs)
+{
+    std::vector<std::string> ycnoList;
+    std::string startTime;
+    std::string endTime;
+    int interval = 5; // 默认间隔
+
+    if (!parseAddress(address, ycnoList, startTime, endTime, interval)) {
+        throw std::runtime_error("地址解析失败: " + address);
+    }
+
+    if (ycnoList.empty()) {
+        throw std::runtime_error("地址中未包含有效的YCNO编号");
+    }
+
+    const QString timeFormat = "yyyy-MM-dd HH:mm:ss";
+    QDateTime rangeStart = QDateTime::fromString(QString::fromStdString(startTime), timeFormat);
+    QDateTime rangeEnd = QDateTime::fromString(QString::fromStdString(endTime), timeFormat);
+
+    // 单点查询或时间格式无法识别时，退化为一次性读取
+    if (!rangeStart.isValid() || !rangeEnd.isValid() || interval <= 0 || m_streamChunkRows <= 0) {
+        return consumer(readColumnar(ycnoList, startTime, endTime, interval, readElapsedMs));
+    }
+
+    const qint64 chunkSecs = (qint64)interval * m_streamChunkRows;
+    int64_t lastDelivered = std::numeric_limits<int64_t>::min();
+    QDateTime chunkStart = rangeStart;
+
+    while (chunkStart <= rangeEnd) {
+        QDateTime chunkEnd = chunkStart.addSecs(chunkSecs);
+        bool lastChunk = (chunkEnd >= rangeEnd);
+
+        // 分段终点与下一段起点相同，保证边界采样点不论端点开闭都不会丢失
+        TaosColumnarData chunk = readColumnar(ycnoList,
+            chunkStart.toString(timeFormat).toStdString(),
+            lastChunk ? endTime : chunkEnd.toString(timeFormat).toStdString(),
+            interval,
+            readElapsedMs);
+
+        dropDelivered(chunk, lastDelivered);
+        if (!chunk.empty()) {
+            lastDelivered = chunk.timestamps.back();
+            if (!consumer(chunk)) {
+                return false;
+            }
+        }
+
+        if (lastChunk) {
+            break;
+        }
+        chunkStart = chunkEnd;
+    }
+
+    return true;
+}
+
+TaosColumnarData TaosDataFetcher::fetchAtTimestamps(const std::vector<std::string>& ycnoList,
+    std::vector<int64_t> timestampsMs,
+    int64_t toleranceMs,
+    TimestampFetchStats* stats,
+    const CancelCheck& cancelled,
+    const WindowProgress& progress)
+{
+    if (ycnoList.empty()) {
+        throw std::runtime_error("未指定有效的YCNO编号");
+    }
+
+    TaosColumnarData result;
+    result.columns.resize(ycnoList.size());
+
+    std::sort(timestampsMs.begin(), timestampsMs.end());
+    timestampsMs.erase(std::unique(timestampsMs.begin(), timestampsMs.end()), timestampsMs.end());
+
+    TimestampFetchStats localStats;
+    TimestampFetchStats& counts = stats ? *stats : localStats;
+    counts = TimestampFetchStats();
+    counts.windowCount = (int)timestampsMs.size();
+    if (timestampsMs.empty()) {
+        return result;
+    }
+
+    // 每个时间点读取 [t, t+容差] 窗口，间隔取容差：与逐日查询的窗口完全一致。
+    // 后端的间隔窗口按纪元对齐而非按查询起点，不能用一次大范围读取代替离散时间点
+    const int intervalSecs = (int)std::max<int64_t>(1, toleranceMs / 1000);
+    const QString timeFormat = "yyyy-MM-dd HH:mm:ss";
+    const int windowCount = counts.windowCount;
+
+    // 各窗口的读取结果
+    enum WindowState { Skipped, Read, Failed };
+
+    // 各窗口经连接池并发读取，对调用方仍是一次批量请求
+    QVector<TaosColumnarData> windows(windowCount);
+    QVector<QString> errors(windowCount);
+    QVector<int> states(windowCount, Skipped);
+    TaosColumnarData* windowData = windows.data();
+    QString* errorData = errors.data();
+    int* stateData = states.data();
+    QAtomicInt finishedCount(0);
+    QThreadPool windowPool;
+    windowPool.setMaxThreadCount(qBound(1, TaosConnectionPool::instance().maxSize(), windowCount));
+    for (int i = 0; i < windowCount; ++i) {
+        QtConcurrent::run(&windowPool, [this, &ycnoList, &timestampsMs, &timeFormat, &cancelled, &progress,
+            &finishedCount, toleranceMs, intervalSecs, windowCount, windowData, errorData, stateData, i]() {
+            if (cancelled && cancelled()) {
+                return;
+            }
+
+            const std::string startTime = QDateTime::fromMSecsSinceEpoch(timestampsMs[i])
+                .toString(timeFormat).toStdString();
+            const std::string endTime = QDateTime::fromMSecsSinceEpoch(timestampsMs[i] + toleranceMs)
+                .toString(timeFormat).toStdString();
+            try {
+                windowData[i] = readColumnar(ycnoList, startTime, endTime, intervalSecs);
+                stateData[i] = Read;
+            }
+            catch (const std::exception& e) {
+                errorData[i] = QString::fromUtf8(e.what());
+                stateData[i] = Failed;
+            }
+
+            if (progress) {
+                progress(finishedCount.fetchAndAddOrdered(1) + 1, windowCount);
+            }
+        });
+    }
+    windowPool.waitForDone();
+
+    // 按时间顺序拼接；相邻窗口重叠时去除重复行
+    int64_t lastDelivered = std::numeric_limits<int64_t>::min();
+    QString firstError;
+    for (int i = 0; i < windowCount; ++i) {
+        const QString timeText = QDateTime::fromMSecsSinceEpoch(timestampsMs[i]).toString(timeFormat);
+        if (states[i] == Skipped) {
+            counts.skipped++;
+            continue;
+        }
+        if (states[i] == Failed) {
+            qWarning() << "时间点查询失败：" << timeText << errors[i];
+            if (firstError.isEmpty()) {
+                firstError = errors[i];
+            }
+            counts.failed++;
+            continue;
+        }
+
+        TaosColumnarData& window = windows[i];
+        if (window.empty()) {
+            qWarning() << "时间点查询无数据：" << timeText;
+            counts.empty++;
+            continue;
+        }
+        counts.succeeded++;
+
+        dropDelivered(window, lastDelivered);
+        if (window.empty()) {
+            continue;
+        }
+        lastDelivered = window.timestamps.back();
+
+        result.timestamps.insert(result.timestamps.end(), window.timestamps.begin(), window.timestamps.end());
+        for (size_t c = 0; c < result.columns.size() && c < window.columns.size(); ++c) {
+            result.columns[c].insert(result.columns[c].end(), window.columns[c].begin(), window.columns[c].end());
+        }
+        window = TaosColumnarData();
+    }
+
+    if (counts.failed == windowCount) {
+        throw std::runtime_error(firstError.toStdString());
+    }
+    if (result.empty() && counts.skipped == 0) {
+        qWarning() << "未获取到有效数据，请检查taos连接";
+    }
+
+    return result;
+}
+
+TaosColumnarData TaosDataFetcher::readColumnar(const std::vector<std::string>& ycnoList,
+    const std::string& startTime,
+    const std::string& endTime,
+    int interval,
+    double* readElapsedMs)
+{
     try {
+        // 从连接池借出句柄，读取完成后随租约析构自动归还
+        TaosConnectionPool::Lease connection = TaosConnectionPool::instance().acquire();
+
+        // 计时从借到连接开始，排队等待连接的时间不计入
+        QElapsedTimer timer;
+        timer.start();
+
         // 使用带时间间隔的查询
-        auto result = tdb->read(ycnoList, startTime, endTime, interval);
+        auto result = connection->read(ycnoList, startTime, endTime, interval);
         //std::map<int64_t, vector<float>> result = tdb->read(ycnoList, startTime, endTime);
-        if (result.empty())
-        {
-            //QMessageBox::warning(NULL, "警告", "未获取到有效数据，请检查taos连接", QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
-            qWarning() << "未获取到有效数据，请检查taos连接";
+        TaosColumnarData data = toColumnar(result, ycnoList.size());
+        if (readElapsedMs) {
+            *readElapsedMs += timer.nsecsElapsed() / 1e6;
         }
-        return result;
+        return data;
     }
     catch (const std::exception& e) {
         throw std::runtime_error(std::string("数据查询失败: ") + e.what());
     }
 }
 
-std::map<int64_t, std::vector<float>> TaosDataFetcher::parseAndFetchData(const std::string& address)
+void TaosDataFetcher::dropDelivered(TaosColumnarData& chunk, int64_t lastTimestamp)
+{
+    if (chunk.empty() || chunk.timestamps.front() > lastTimestamp) {
+        return;
+    }
+
+    auto firstNew = std::upper_bound(chunk.timestamps.begin(), chunk.timestamps.end(), lastTimestamp);
+    const size_t dropCount = firstNew - chunk.timestamps.begin();
+
+    chunk.timestamps.erase(chunk.timestamps.begin(), firstNew);
+    for (auto& column : chunk.columns) {
+        column.erase(column.begin(), column.begin() + std::min(dropCount, column.size()));
+    }
+}
+
+TaosColumnarData TaosDataFetcher::parseAndFetchData(const std::string& address)
 {
     return fetchDataFromAddress(address);
 }
 
-std::map<std::string, std::map<int64_t, std::vector<float>>> TaosDataFetcher::fetchMultipleData(const std::vector<std::string>& addresses)
+std::map<std::string, TaosColumnarData> TaosDataFetcher::fetchMultipleData(const std::vector<std::string>& addresses)
 {
-    std::map<std::string, std::map<int64_t, std::vector<float>>> result;
+    std::map<std::string, TaosColumnarData> result;
 
     for (const auto& address : addresses) {
         try {
@@ -70,6 +290,46 @@ std::map<std::string, std::map<int64_t, std::vector<float>>> TaosDataFetcher::fe
     return result;
 }
 
+TaosColumnarData TaosDataFetcher::toColumnar(const std::map<int64_t, std::vector<float>>& rows,
+    size_t columnCount)
+{
+    TaosColumnarData data;
+    if (rows.empty()) {
+        data.columns.resize(columnCount);
+        return data;
+    }
+
+    // 检测时间戳单位：毫秒值落在 2000~2100 年之间视为毫秒，否则按秒处理
+    const int64_t MS_LOWER = 946684800000LL;    // 2000-01-01 00:00:00 UTC
+    const int64_t MS_UPPER = 4102444800000LL;   // 2100-01-01 00:00:00 UTC
+    const int64_t firstTs = rows.begin()->first;
+    const bool isMilliseconds = (firstTs >= MS_LOWER && firstTs <= MS_UPPER);
+    const int64_t scale = isMilliseconds ? 1 : 1000;
+
+    const size_t rowCount = rows.size();
+    data.timestamps.reserve(rowCount);
+    data.columns.resize(columnCount);
+    for (auto& column : data.columns) {
+        column.reserve(rowCount);
+    }
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (auto it = rows.begin(); it != rows.end(); ++it) {
+        data.timestamps.push_back(it->first * scale);
+
+        const std::vector<float>& values = it->second;
+        const size_t valueCount = std::min(values.size(), columnCount);
+        for (size_t i = 0; i < valueCount; ++i) {
+            data.columns[i].push_back(values[i]);
+        }
+        for (size_t i = valueCount; i < columnCount; ++i) {
+            data.columns[i].push_back(nan);
+        }
+    }
+
+    return data;
+}
+
 bool TaosDataFetcher::parseAddress(const std::string& address,
     std::vector<std::string>& ycnoList,
     std::string& startTime,
@@ -5,24 +5,106 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <functional>
 #include "taosdbapi.h"
 #include <QObject>
 #include <QString>
 
+/**
+ * @brief 列式查询结果
+ * timestamps 为升序毫秒时间戳；columns[i] 对应查询地址中第 i 个 YCNO，
+ * 长度与 timestamps 一致，缺失值以 NaN 填充
+ */
+struct TaosColumnarData
+{
+    std::vector<int64_t> timestamps;
+    std::vector<std::vector<float>> columns;
+
+    bool empty() const { return timestamps.empty(); }
+    size_t rowCount() const { return timestamps.size(); }
+    size_t columnCount() const { return columns.size(); }
+
+    // 追加一段时间上更晚的数据（列数需一致）
+    void append(const TaosColumnarData& other)
+    {
+        timestamps.insert(timestamps.end(), other.timestamps.begin(), other.timestamps.end());
+        if (columns.size() < other.columns.size()) {
+            columns.resize(other.columns.size());
+        }
+        for (size_t i = 0; i < other.columns.size(); ++i) {
+            columns[i].insert(columns[i].end(), other.columns[i].begin(), other.columns[i].end());
+        }
+    }
+};
+
+/**
+ * @brief TDengine 数据查询器
+ * 自身不持有连接，每次读取从 TaosConnectionPool 借出句柄，可在多个线程中并发使用
+ */
 class TaosDataFetcher
 {
 public:
     TaosDataFetcher();
     ~TaosDataFetcher();
 
-    // 从地址字符串获取数据
-    std::map<int64_t, std::vector<float>> fetchDataFromAddress(const std::string& address);
+    // 从地址字符串获取数据（列式，时间戳统一为毫秒）
+    TaosColumnarData fetchDataFromAddress(const std::string& address);
 
     // 解析地址字符串并获取数据
-    std::map<int64_t, std::vector<float>> parseAndFetchData(const std::string& address);
+    TaosColumnarData parseAndFetchData(const std::string& address);
 
     // 批量获取多个地址的数据
-    std::map<std::string, std::map<int64_t, std::vector<float>>> fetchMultipleData(const std::vector<std::string>& addresses);
+    std::map<std::string, TaosColumnarData> fetchMultipleData(const std::vector<std::string>& addresses);
+
+    // 分段消费回调：返回 false 表示中止后续读取（如用户取消）
+    using ChunkConsumer = std::function<bool(const TaosColumnarData& chunk)>;
+
+    /**
+     * @brief 流式获取数据
+     * 按 streamChunkRows 个采样间隔切分时间范围逐段读取，每段结果按时间升序交给 consumer，
+     * 峰值内存与分段大小成正比，而非整个时间范围
+     * @param readElapsedMs 非空时累加各分段借到连接之后的读取耗时（不含等待连接与 consumer 处理）
+     * @return 全部分段读取完成返回 true，被 consumer 中止返回 false
+     */
+    bool fetchStreaming(const std::string& address, const ChunkConsumer& consumer,
+        double* readElapsedMs = nullptr);
+
+    // 离散时间点查询的逐窗口统计（每个去重后的时间点一个窗口）
+    struct TimestampFetchStats {
+        int windowCount = 0;    // 窗口总数
+        int succeeded = 0;      // 读取成功且有数据
+        int empty = 0;          // 读取成功但无数据
+        int failed = 0;         // 读取出错
+        int skipped = 0;        // 取消后未开始读取
+    };
+
+    // 窗口开始读取前检查：返回 true 表示已取消，尚未开始的窗口不再读取
+    using CancelCheck = std::function<bool()>;
+    // 每个窗口读取结束后回调（在工作线程中调用），finished 为已结束的窗口数
+    using WindowProgress = std::function<void(int finished, int total)>;
+
+    /**
+     * @brief 离散时间点批量查询
+     * 每个时间点读取 [t, t+toleranceMs] 窗口（间隔为 toleranceMs），
+     * 各窗口经连接池并发读取后按时间顺序合并
+     * @param ycnoList YCNO 列表
+     * @param timestampsMs 目标时间点（毫秒，无需有序）
+     * @param toleranceMs 每个时间点的窗口长度（毫秒）
+     * @param stats 非空时写入逐窗口的成功/无数据/失败/跳过个数（抛出异常前同样写入）
+     * @param cancelled 非空时在每个窗口开始前检查
+     * @param progress 非空时在每个窗口结束后回调
+     * @return 列式结果，按时间升序；全部窗口失败时抛出异常
+     */
+    TaosColumnarData fetchAtTimestamps(const std::vector<std::string>& ycnoList,
+        std::vector<int64_t> timestampsMs,
+        int64_t toleranceMs,
+        TimestampFetchStats* stats = nullptr,
+        const CancelCheck& cancelled = CancelCheck(),
+        const WindowProgress& progress = WindowProgress());
+
+    // 每个分段包含的采样间隔数（默认 10000）
+    void setStreamChunkRows(int rows) { m_streamChunkRows = rows; }
+    int streamChunkRows() const { return m_streamChunkRows; }
 
     // 工具方法：时间戳转字符串
     static std::string timestampToString(time_t timestamp);
@@ -35,8 +117,21 @@ private:
         std::string& endTime,
         int& interval);
 
-    // 数据库API对象
-    taosdbapi* tdb;
+    // 读取一段时间范围并转换为列式结果（readElapsedMs 非空时累加借到连接后的耗时）
+    TaosColumnarData readColumnar(const std::vector<std::string>& ycnoList,
+        const std::string& startTime,
+        const std::string& endTime,
+        int interval,
+        double* readElapsedMs = nullptr);
+
+    // 丢弃时间戳不大于 lastTimestamp 的行（相邻分段在边界点重叠读取）
+    static void dropDelivered(TaosColumnarData& chunk, int64_t lastTimestamp);
+
+    // 将行式结果转换为列式，并在此边界统一时间戳单位为毫秒
+    static TaosColumnarData toColumnar(const std::map<int64_t, std::vector<float>>& rows,
+        size_t columnCount);
+
+    int m_streamChunkRows;
 };
 
 #endif // TAOSDATAFETCHER_H
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "TimeAxis.h"
+#include "DataBindingConfig.h"
+
+namespace {
+
+const int64_t kMsPerDay = 24LL * 3600 * 1000;
+
+// 每线程缓存当天的本地零点与日期前缀 "yyyy-MM-dd "
+struct DayCache {
+    int64_t dayStartMs = 0;
+    int64_t dayEndMs = 0;       // 空区间表示无缓存
+    QChar prefix[11];
+};
+
+thread_local DayCache t_dayCache;
+
+inline void putTwoDigits(QChar* out, int value)
+{
+    out[0] = QChar('0' + value / 10);
+    out[1] = QChar('0' + value % 10);
+}
+
+bool loadDay(DayCache& cache, int64_t msecsSinceEpoch)
+{
+    const QDate date = QDateTime::fromMSecsSinceEpoch(msecsSinceEpoch).date();
+    const int64_t dayStart = QDateTime(date, QTime(0, 0, 0)).toMSecsSinceEpoch();
+    const int64_t dayEnd = QDateTime(date.addDays(1), QTime(0, 0, 0)).toMSecsSinceEpoch();
+
+    // 夏令时切换日的时分秒不能由毫秒差直接换算
+    if (dayEnd - dayStart != kMsPerDay) {
+        cache.dayEndMs = cache.dayStartMs;
+        return false;
+    }
+
+    const QString prefix = date.toString("yyyy-MM-dd ");
+    if (prefix.size() != 11) {
+        cache.dayEndMs = cache.dayStartMs;
+        return false;
+    }
+
+    cache.dayStartMs = dayStart;
+    cache.dayEndMs = dayEnd;
+    for (int i = 0; i < 11; ++i) {
+        cache.prefix[i] = prefix.at(i);
+    }
+    return true;
+}
+
+} // namespace
+
+TimeAxis TimeAxis::fromConfig(const TimeRangeConfig& config)
+{
+    TimeAxis axis;
+    if (!config.isValid()) {
+        return axis;
+    }
+
+    axis.startMs = config.startTime.toMSecsSinceEpoch();
+
+    // 单点查询（间隔为0）
+    if (config.intervalSeconds == 0) {
+        axis.count = 1;
+        return axis;
+    }
+
+    // 与逐点 addSecs 直到超过终止时间的点数一致
+    axis.stepMs = (int64_t)config.intervalSeconds * 1000;
+    const qint64 totalSeconds = config.startTime.secsTo(config.endTime);
+    axis.count = (int)(totalSeconds / config.intervalSeconds + 1);
+    return axis;
+}
+
+std::vector<int64_t> TimeAxis::toMsVector() const
+{
+    std::vector<int64_t> result;
+    if (count <= 0) {
+        return result;
+    }
+
+    result.resize(count);
+    int64_t current = startMs;
+    for (int i = 0; i < count; ++i) {
+        result[i] = current;
+        current += stepMs;
+    }
+    return result;
+}
+
+QString TimeAxis::formatMs(int64_t msecsSinceEpoch)
+{
+    DayCache& cache = t_dayCache;
+    if (msecsSinceEpoch < cache.dayStartMs || msecsSinceEpoch >= cache.dayEndMs) {
+        if (!loadDay(cache, msecsSinceEpoch)) {
+            return QDateTime::fromMSecsSinceEpoch(msecsSinceEpoch).toString("yyyy-MM-dd HH:mm:ss");
+        }
+    }
+
+    const int secondOfDay = (int)((msecsSinceEpoch - cache.dayStartMs) / 1000);
+
+    QString result(19, Qt::Uninitialized);
+    QChar* out = result.data();
+    for (int i = 0; i < 11; ++i) {
+        out[i] = cache.prefix[i];
+    }
+    putTwoDigits(out + 11, secondOfDay / 3600);
+    out[13] = QChar(':');
+    putTwoDigits(out + 14, secondOfDay / 60 % 60);
+    out[16] = QChar(':');
+    putTwoDigits(out + 17, secondOfDay % 60);
+    return result;
+}
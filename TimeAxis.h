@@ -0,0 +1,49 @@
+#pragma once
+#ifndef TIMEAXIS_H
+#define TIMEAXIS_H
+
+#include <QString>
+#include <QDateTime>
+#include <vector>
+#include <cstdint>
+
+struct TimeRangeConfig;
+
+/**
+ * @brief 等间隔时间轴（隐式表示）
+ * 只保存起点、步长和点数，第 i 个时间点为 startMs + i * stepMs（毫秒，UTC 纪元）。
+ * 与逐点 addSecs 生成的 QDateTime 序列一一对应，但不为每个时间点分配对象。
+ */
+struct TimeAxis
+{
+    int64_t startMs;
+    int64_t stepMs;
+    int count;
+
+    TimeAxis() : startMs(0), stepMs(0), count(0) {}
+
+    /**
+     * @brief 按时间配置生成时间轴（间隔为 0 时为单点）
+     */
+    static TimeAxis fromConfig(const TimeRangeConfig& config);
+
+    bool isEmpty() const { return count <= 0; }
+    int size() const { return count; }
+    int64_t at(int i) const { return startMs + stepMs * i; }
+    QDateTime dateTimeAt(int i) const { return QDateTime::fromMSecsSinceEpoch(at(i)); }
+
+    /**
+     * @brief 展开为毫秒数组（供对齐归并使用）
+     */
+    std::vector<int64_t> toMsVector() const;
+
+    /**
+     * @brief 格式化为本地时间 "yyyy-MM-dd HH:mm:ss"
+     * 同一天内只计算一次日期部分（每线程缓存），时分秒由毫秒差直接换算；
+     * 当天长度不是 24 小时（夏令时切换日）时退回 QDateTime 格式化。
+     */
+    static QString formatMs(int64_t msecsSinceEpoch);
+    QString formatAt(int i) const { return formatMs(at(i)); }
+};
+
+#endif // TIMEAXIS_H
@@ -163,6 +163,50 @@ void TimeSettingsDialog::setupUI()
     intervalMainLayout->addLayout(quickLayout);
     mainLayout->addWidget(m_intervalGroup);
 
+    // ===== 数据对齐 =====
+    QGroupBox* alignGroup = new QGroupBox("数据对齐");
+    QHBoxLayout* alignLayout = new QHBoxLayout(alignGroup);
+
+    QLabel* alignLabel = new QLabel("取值方式：");
+    m_alignPolicyCombo = new QComboBox();
+    m_alignPolicyCombo->addItem("最近点", TimeRangeConfig::AlignNearest);
+    m_alignPolicyCombo->addItem("前值", TimeRangeConfig::AlignPrevious);
+    m_alignPolicyCombo->addItem("后值", TimeRangeConfig::AlignNext);
+    m_alignPolicyCombo->addItem("线性插值", TimeRangeConfig::AlignLinear);
+    m_alignPolicyCombo->setCurrentIndex(0);
+
+    alignLayout->addWidget(alignLabel);
+    alignLayout->addWidget(m_alignPolicyCombo);
+    alignLayout->addStretch();
+
+    mainLayout->addWidget(alignGroup);
+
+    // ===== 分片查询 =====
+    const TimeRangeConfig defaults;
+    QGroupBox* shardGroup = new QGroupBox("分片查询");
+    QHBoxLayout* shardLayout = new QHBoxLayout(shardGroup);
+
+    QLabel* shardHoursLabel = new QLabel("分片时长：");
+    m_shardHoursSpinBox = new QSpinBox();
+    m_shardHoursSpinBox->setRange(0, 24 * 31);
+    m_shardHoursSpinBox->setSuffix(" 小时");
+    m_shardHoursSpinBox->setSpecialValueText("不分片");
+    m_shardHoursSpinBox->setValue(defaults.shardSeconds / 3600);
+
+    QLabel* shardConcurrencyLabel = new QLabel("并发数：");
+    m_shardConcurrencySpinBox = new QSpinBox();
+    m_shardConcurrencySpinBox->setRange(1, 16);
+    m_shardConcurrencySpinBox->setValue(defaults.shardConcurrency);
+
+    shardLayout->addWidget(shardHoursLabel);
+    shardLayout->addWidget(m_shardHoursSpinBox);
+    shardLayout->addSpacing(20);
+    shardLayout->addWidget(shardConcurrencyLabel);
+    shardLayout->addWidget(m_shardConcurrencySpinBox);
+    shardLayout->addStretch();
+
+    mainLayout->addWidget(shardGroup);
+
     // ===== 底部按钮 =====
     mainLayout->addStretch();
 
@@ -462,6 +506,40 @@ int TimeSettingsDialog::getIntervalSeconds() const
 }
 
 
+TimeRangeConfig::AlignPolicy TimeSettingsDialog::getAlignPolicy() const
+{
+    return static_cast<TimeRangeConfig::AlignPolicy>(m_alignPolicyCombo->currentData().toInt());
+}
+
+void TimeSettingsDialog::setAlignPolicy(TimeRangeConfig::AlignPolicy policy)
+{
+    int index = m_alignPolicyCombo->findData(policy);
+    if (index >= 0) {
+        m_alignPolicyCombo->setCurrentIndex(index);
+    }
+}
+
+int TimeSettingsDialog::getShardSeconds() const
+{
+    return m_shardHoursSpinBox->value() * 3600;
+}
+
+int TimeSettingsDialog::getShardConcurrency() const
+{
+    return m_shardConcurrencySpinBox->value();
+}
+
+void TimeSettingsDialog::setShardSeconds(int seconds)
+{
+    // 不足一小时的分片按一小时显示
+    m_shardHoursSpinBox->setValue(seconds <= 0 ? 0 : qMax(1, seconds / 3600));
+}
+
+void TimeSettingsDialog::setShardConcurrency(int concurrency)
+{
+    m_shardConcurrencySpinBox->setValue(concurrency);
+}
+
 TimeSettingsDialog::ReportType TimeSettingsDialog::getReportType() const
 {
     return m_currentType;
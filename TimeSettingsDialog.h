@@ -15,6 +15,7 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QButtonGroup>
+#include "DataBindingConfig.h"
 
 
 class TimeSettingsDialog : public QDialog
@@ -38,11 +39,17 @@ public:
     int getIntervalSeconds() const;
     ReportType getReportType() const;
     bool isSinglePointMode() const;  // 新增：判断是否为单点模式
+    TimeRangeConfig::AlignPolicy getAlignPolicy() const;
+    int getShardSeconds() const;      // 分片时长（秒），0 表示不分片
+    int getShardConcurrency() const;  // 分片查询并发数
 
 
     // 设置初始值（用于记忆上次选择）
     void setStartTime(const QDateTime& time);
     void setReportType(ReportType type);
+    void setAlignPolicy(TimeRangeConfig::AlignPolicy policy);
+    void setShardSeconds(int seconds);
+    void setShardConcurrency(int concurrency);
 
 private slots:
     void onReportTypeChanged(int id);
@@ -85,6 +92,11 @@ private:
     QPushButton* m_quick5MinBtn;
     QPushButton* m_quick1HourBtn;
 
+    QComboBox* m_alignPolicyCombo;  // 对齐策略
+
+    QSpinBox* m_shardHoursSpinBox;       // 分片时长（小时）
+    QSpinBox* m_shardConcurrencySpinBox; // 分片并发数
+
     QPushButton* m_okBtn;
     QPushButton* m_cancelBtn;
 
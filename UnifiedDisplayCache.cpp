@@ -0,0 +1,138 @@
+#include "UnifiedDisplayCache.h"
+#include "UnifiedQueryParser.h"
+
+#include <cmath>
+
+// 窗口最少覆盖的行数（可视行较少时仍按此预取）
+static const int kMinPageRows = 64;
+
+UnifiedDisplayCache::UnifiedDisplayCache()
+    : m_firstRow(0)
+    , m_rowCount(0)
+    , m_columnCount(0)
+{
+}
+
+void UnifiedDisplayCache::reset(const std::shared_ptr<const UnifiedQueryResult>& result)
+{
+    // 同一次查询的后续快照共享列缓冲，已缓存的行都已定稿，窗口可以保留
+    const bool continued = m_result && result && result->sharesDataWith(*m_result);
+    m_result = result;
+    if (continued) {
+        return;
+    }
+
+    m_firstRow = 0;
+    m_rowCount = 0;
+    m_columnCount = (result && !result->isEmpty()) ? result->columns.size() + 1 : 0;
+    m_texts.clear();
+}
+
+void UnifiedDisplayCache::ensureRows(int firstRow, int lastRow)
+{
+    if (m_columnCount == 0) {
+        return;
+    }
+
+    const int totalRows = m_result->readyRows;
+    if (totalRows <= 0) {
+        return;
+    }
+    firstRow = qBound(0, firstRow, totalRows - 1);
+    lastRow = qBound(firstRow, lastRow, totalRows - 1);
+    if (firstRow >= m_firstRow && lastRow < m_firstRow + m_rowCount) {
+        return;
+    }
+
+    const int pageRows = qMax(kMinPageRows, lastRow - firstRow + 1);
+    const int newFirst = qMax(0, firstRow - pageRows);
+    const int newLast = qMin(totalRows - 1, lastRow + 2 * pageRows);
+    const int newCount = newLast - newFirst + 1;
+
+    // 与旧窗口重叠的行直接复用（QString 隐式共享），其余行重新格式化
+    QVector<QString> texts(newCount * m_columnCount);
+    QString* dst = texts.data();
+    for (int r = 0; r < newCount; ++r) {
+        const int row = newFirst + r;
+        const int oldIndex = row - m_firstRow;
+        if (oldIndex >= 0 && oldIndex < m_rowCount) {
+            const QString* src = m_texts.constData() + oldIndex * m_columnCount;
+            for (int c = 0; c < m_columnCount; ++c) {
+                *dst++ = src[c];
+            }
+        }
+        else {
+            for (int c = 0; c < m_columnCount; ++c) {
+                *dst++ = formatCell(row, c);
+            }
+        }
+    }
+
+    m_texts.swap(texts);
+    m_firstRow = newFirst;
+    m_rowCount = newCount;
+}
+
+const QString* UnifiedDisplayCache::text(int dataRow, int column)
+{
+    if (m_columnCount == 0 || column < 0 || column >= m_columnCount ||
+        dataRow < 0 || dataRow >= m_result->readyRows) {
+        return nullptr;
+    }
+
+    if (dataRow < m_firstRow || dataRow >= m_firstRow + m_rowCount) {
+        ensureRows(dataRow, dataRow);
+    }
+    return &m_texts[(dataRow - m_firstRow) * m_columnCount + column];
+}
+
+QString UnifiedDisplayCache::formatCell(int dataRow, int column) const
+{
+    if (column == 0) {
+        return m_result->timeAxis.formatAt(dataRow);
+    }
+
+    const QVector<double>* values = m_result->column(column - 1);
+    if (!values || dataRow >= values->size()) {
+        return QStringLiteral("N/A");
+    }
+
+    const double value = values->at(dataRow);
+    if (std::isnan(value) || std::isinf(value)) {
+        return QStringLiteral("N/A");
+    }
+    return formatFixed2(value);
+}
+
+QString UnifiedDisplayCache::formatFixed2(double value)
+{
+    const double scaled = std::fabs(value) * 100.0;
+
+    // 非有限值、超出整数精度或恰好落在进位边界时交给 QString::number，保证结果一致
+    if (!(scaled < 9.0e15) || scaled - std::floor(scaled) == 0.5) {
+        return QString::number(value, 'f', 2);
+    }
+
+    qint64 units = (qint64)std::llround(scaled);
+    if (units == 0 && std::signbit(value)) {
+        return QString::number(value, 'f', 2);  // 负零的符号处理交给 Qt
+    }
+
+    QChar buffer[24];
+    int pos = 24;
+    const int fraction = (int)(units % 100);
+    buffer[--pos] = QChar('0' + fraction % 10);
+    buffer[--pos] = QChar('0' + fraction / 10);
+    buffer[--pos] = QChar('.');
+
+    qint64 integer = units / 100;
+    do {
+        buffer[--pos] = QChar('0' + (int)(integer % 10));
+        integer /= 10;
+    } while (integer > 0);
+
+    if (value < 0) {
+        buffer[--pos] = QChar('-');
+    }
+    return QString(buffer + pos, 24 - pos);
+}
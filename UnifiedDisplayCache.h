@@ -0,0 +1,59 @@
+#pragma once
+#ifndef UNIFIEDDISPLAYCACHE_H
+#define UNIFIEDDISPLAYCACHE_H
+
+#include <QString>
+#include <QVector>
+#include <memory>
+
+struct UnifiedQueryResult;
+
+/**
+ * @brief 统一查询显示文本缓存
+ * 只为可视区域附近的一段行预先格式化显示文本（时间列 + 各数据列），
+ * 重绘时直接返回缓存的 QString（隐式共享，复制无开销）。
+ * 窗口按滚动位置向前后延伸，移动窗口时与旧窗口重叠的行直接复用。
+ * 只缓存快照中已定稿的行；同一次查询的后续快照到达时保留已有窗口。
+ * 仅在 GUI 线程使用。
+ */
+class UnifiedDisplayCache
+{
+public:
+    UnifiedDisplayCache();
+
+    /**
+     * @brief 绑定新的结果快照并清空缓存（快照为空时缓存失效）
+     * 新快照与当前快照属于同一次查询时只更新快照，保留已格式化的行
+     */
+    void reset(const std::shared_ptr<const UnifiedQueryResult>& result);
+
+    /**
+     * @brief 确保 [firstRow, lastRow]（数据行号，不含表头）附近的行已格式化
+     * 窗口向下多预取两屏、向上保留一屏
+     */
+    void ensureRows(int firstRow, int lastRow);
+
+    /**
+     * @brief 取缓存的显示文本；未命中时按需移动窗口
+     * @param dataRow 数据行号（不含表头）
+     * @param column 0 为时间列，1..N 为数据列
+     * @return 越界或该行尚未定稿时返回空指针
+     */
+    const QString* text(int dataRow, int column);
+
+    /**
+     * @brief 保留两位小数的定点格式化，结果与 QString::number(value, 'f', 2) 一致
+     */
+    static QString formatFixed2(double value);
+
+private:
+    QString formatCell(int dataRow, int column) const;
+
+    std::shared_ptr<const UnifiedQueryResult> m_result;
+    int m_firstRow;             // 窗口首行（数据行号）
+    int m_rowCount;             // 窗口行数
+    int m_columnCount;          // 每行列数（时间列 + 数据列）
+    QVector<QString> m_texts;   // 行优先存放
+};
+
+#endif // UNIFIEDDISPLAYCACHE_H
@@ -1,13 +1,109 @@
 #include "UnifiedQueryParser.h"
 #include "reportdatamodel.h"
 #include "TaosDataFetcher.h"
+#include "RtuDictionary.h"
 #include <QMessageBox>
 #include <QtConcurrent>
 #include <QProgressDialog>
 #include <cmath>
+#include <algorithm>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <deque>
+
+// 部分快照的最小发布间隔（毫秒）：首批定稿行立即发布，之后按此限频刷新界面
+static const int kPartialPublishIntervalMs = 250;
+
+// 每个在途分片最多缓冲的分段数：拼接线程跟不上时分片线程暂停读取
+static const int kShardQueueChunks = 2;
+
+/**
+ * @brief 单个分片的有界分段队列
+ * 分片线程读到一段就放入队列，拼接线程按时间顺序逐段取出对齐；
+ * 队列满时分片线程阻塞，峰值内存为 在途分片数 × 队列容量 × 分段大小。
+ */
+class UnifiedQueryParser::ShardChannel
+{
+public:
+    /**
+     * @brief 放入一段数据（队列满时等待）
+     * @return 已被中止时返回 false
+     */
+    bool push(const TaosColumnarData& chunk)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_aborted && (int)m_chunks.size() >= kShardQueueChunks) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_aborted) {
+            return false;
+        }
+        m_chunks.push_back(chunk);
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    /**
+     * @brief 分片读取结束（completed 表示完整读取，error 非空表示失败）
+     */
+    void finish(bool completed, const QString& error)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_finished = true;
+        m_completed = completed;
+        m_error = error;
+        m_notEmpty.wakeOne();
+    }
+
+    /**
+     * @brief 取出下一段（队列空时等待）
+     * @return 分片已结束且队列已空时返回 false
+     */
+    bool pop(TaosColumnarData& chunk)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_chunks.empty() && !m_finished) {
+            m_notEmpty.wait(&m_mutex);
+        }
+        if (m_chunks.empty()) {
+            return false;
+        }
+        chunk = std::move(m_chunks.front());
+        m_chunks.pop_front();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    /**
+     * @brief 中止：丢弃缓冲并唤醒等待中的分片线程
+     */
+    void abort()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_aborted = true;
+        m_chunks.clear();
+        m_notFull.wakeAll();
+    }
+
+    bool aborted() const { QMutexLocker locker(&m_mutex); return m_aborted; }
+    bool completed() const { QMutexLocker locker(&m_mutex); return m_completed; }
+    QString error() const { QMutexLocker locker(&m_mutex); return m_error; }
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    std::deque<TaosColumnarData> m_chunks;
+    bool m_finished = false;
+    bool m_completed = false;
+    bool m_aborted = false;
+    QString m_error;
+};
 
 UnifiedQueryParser::UnifiedQueryParser(ReportDataModel* model, QObject* parent)
     : BaseReportParser(model, parent)
+    , m_result(std::make_shared<UnifiedQueryResult>())
 {
 
 }
@@ -63,6 +159,7 @@ bool UnifiedQueryParser::loadConfigFromCells()
         ReportColumnConfig colConfig;
         colConfig.displayName = displayName;
         colConfig.rtuId = rtuId;
+        colConfig.rtuKey = RtuDictionary::instance().intern(rtuId);
         colConfig.sourceRow = row;
 
         m_config.columns.append(colConfig);
@@ -77,22 +174,33 @@ bool UnifiedQueryParser::loadConfigFromCells()
     return true;
 }
 
-const QVector<QDateTime>& UnifiedQueryParser::getTimeAxis() const
+UnifiedQueryResultPtr UnifiedQueryParser::getResult() const
 {
-    QMutexLocker locker(&m_dataMutex);
-    return m_timeAxis;
+    return std::atomic_load(&m_result);
 }
 
-const QHash<QString, QVector<double>>& UnifiedQueryParser::getAlignedData() const
+void UnifiedQueryParser::publishResult(const UnifiedQueryResultPtr& result)
 {
-    QMutexLocker locker(&m_dataMutex);
-    return m_alignedData;
+    std::atomic_store(&m_result, result);
+    emit resultPublished();
 }
 
-bool UnifiedQueryParser::runAsyncTask()
+bool UnifiedQueryParser::runAsyncTask(const PrefetchPlanPtr& plan)
 {
+    Q_UNUSED(plan);  // 统一查询的时间轴与列配置由 UnifiedQueryParser 自身保存
     qDebug() << "========== 统一查询异步任务开始 ==========";
 
+    // 查询过程中会陆续发布部分结果；失败或取消时恢复查询前的快照
+    const UnifiedQueryResultPtr previous = getResult();
+    const bool ok = runQuery();
+    if (!ok && getResult() != previous) {
+        publishResult(previous);
+    }
+    return ok;
+}
+
+bool UnifiedQueryParser::runQuery()
+{
     if (m_cancelRequested.loadAcquire()) return false;
 
     if (m_config.columns.isEmpty()) {
@@ -108,7 +216,7 @@ bool UnifiedQueryParser::runAsyncTask()
     try {
         // ===== 阶段1：生成时间轴 =====
         emit queryStageChanged("正在生成时间轴...");
-        QVector<QDateTime> timeAxis = generateTimeAxis();
+        TimeAxis timeAxis = generateTimeAxis();
 
 
         if (timeAxis.isEmpty()) {
@@ -118,43 +226,49 @@ bool UnifiedQueryParser::runAsyncTask()
 
         if (m_cancelRequested.loadAcquire()) return false;
 
-        // ===== 阶段2：构造查询地址 =====
+        // ===== 阶段2：规划分片 =====
         emit queryStageChanged("正在构造查询语句...");
-        QString queryAddr = buildQueryAddress();
+        QVector<ShardRange> shards = planShards();
 
         if (m_cancelRequested.loadAcquire()) return false;
 
-        // ===== 阶段3：执行数据库查询 =====
-        emit queryStageChanged(QString("正在查询数据库(%1 个RTU)...").arg(m_config.columns.size()));
-
-        auto queryStartTime = QDateTime::currentDateTime();
-
-        std::map<int64_t, std::vector<float>> rawData = m_fetcher->fetchDataFromAddress(queryAddr.toStdString());
+        // ===== 阶段3：查询并对齐 =====
+        // 数据按分段到达即对齐，不再同时持有完整原始结果与对齐结果
+        emit queryStageChanged(QString("正在查询并对齐数据(%1 个RTU, %2 个时间点)...")
+            .arg(m_config.columns.size()).arg(timeAxis.size()));
 
-        auto queryEndTime = QDateTime::currentDateTime();
+        AlignState alignState;
+        beginAlign(alignState, timeAxis);
 
-        if (rawData.empty()) {
-            qWarning() << "数据库未返回任何数据。";
+        bool completed = false;
+        if (shards.size() > 1) {
+            completed = runShardedQuery(shards, alignState);
+        }
+        else {
+            QString queryAddr = buildQueryAddress(m_timeConfig.startTime, m_timeConfig.endTime);
+            completed = m_fetcher->fetchStreaming(queryAddr.toStdString(),
+                [this, &alignState](const TaosColumnarData& chunk) {
+                    alignChunk(alignState, chunk);
+                    return !m_cancelRequested.loadAcquire();
+                });
         }
 
-        if (m_cancelRequested.loadAcquire()) return false;
-
-        // ===== 阶段4：数据对齐 =====
-        emit queryStageChanged(QString("正在对齐数据(%1 个时间点)...").arg(timeAxis.size()));
+        if (!completed || m_cancelRequested.loadAcquire()) return false;
 
-        auto alignStartTime = QDateTime::currentDateTime();
+        // 列后处理（清理、插值、统计）按列并行
+        emit queryStageChanged("正在整理数据...");
+        if (!alignState.aligner.finish()) return false;
 
-        // ===== 【关键修复】直接传递 timeAxis 参数 =====
-        QHash<QString, QVector<double>> alignedData = alignData(rawData, timeAxis);
+        if (alignState.aligner.rowCount() == 0) {
+            qWarning() << "数据库未返回任何数据。";
+        }
 
-        auto alignEndTime = QDateTime::currentDateTime();
+        emit queryProgressUpdated(timeAxis.size(), timeAxis.size());
+        qDebug() << QString("数据对齐完成：%1/%2 个时间点命中，原始数据 %3 行")
+            .arg(alignState.aligner.matchCount()).arg(timeAxis.size()).arg((qulonglong)alignState.aligner.rowCount());
 
-        // ===== 阶段5：安全地更新成员变量 =====
-        {
-            QMutexLocker locker(&m_dataMutex);
-            m_timeAxis = timeAxis;
-            m_alignedData = alignedData;
-        }
+        // ===== 阶段4：构建完整的只读快照并原子发布 =====
+        publishResult(buildResult(alignState, true));
 
         return true;
 
@@ -176,13 +290,12 @@ bool UnifiedQueryParser::executeQueries(QProgressDialog* progress)
 
 void UnifiedQueryParser::restoreToTemplate()
 {
-    // 清空时间轴和数据（保留配置）
-    m_timeAxis.clear();
-    m_alignedData.clear();
+    // 发布空快照（保留配置）
+    publishResult(std::make_shared<UnifiedQueryResult>());
     qDebug() << "统一查询数据已清空";
 }
 
-QString UnifiedQueryParser::buildQueryAddress()
+QString UnifiedQueryParser::buildQueryAddress(const QDateTime& startTime, const QDateTime& endTime)
 {
     // 收集所有 RTU 号
     QStringList rtuList;
@@ -191,8 +304,8 @@ QString UnifiedQueryParser::buildQueryAddress()
     }
 
     QString rtuPart = rtuList.join(",");
-    QString startStr = m_timeConfig.startTime.toString("yyyy-MM-dd HH:mm:ss");
-    QString endStr = m_timeConfig.endTime.toString("yyyy-MM-dd HH:mm:ss");
+    QString startStr = startTime.toString("yyyy-MM-dd HH:mm:ss");
+    QString endStr = endTime.toString("yyyy-MM-dd HH:mm:ss");
 
     // 格式：RTU1,RTU2@起始时间~结束时间#间隔秒数
     return QString("%1@%2~%3#%4")
@@ -202,147 +315,221 @@ QString UnifiedQueryParser::buildQueryAddress()
         .arg(m_timeConfig.intervalSeconds);
 }
 
-QVector<QDateTime> UnifiedQueryParser::generateTimeAxis()
+QVector<UnifiedQueryParser::ShardRange> UnifiedQueryParser::planShards() const
 {
-    // 【直接复用版本1的 ReportDataModel::generateTimeAxis】
-    QVector<QDateTime> result;
+    QVector<ShardRange> shards;
 
-    if (!m_timeConfig.isValid()) {
-        qWarning() << "时间配置无效";
-        return result;
-    }
+    const int interval = m_timeConfig.intervalSeconds;
+    const qint64 totalSeconds = m_timeConfig.startTime.secsTo(m_timeConfig.endTime);
 
-    // 单点查询（间隔为0）
-    if (m_timeConfig.intervalSeconds == 0) {
-        result.append(m_timeConfig.startTime);
-        return result;
+    // 单点查询、未启用分片或跨度不足一个分片时不拆分
+    if (interval <= 0 || m_timeConfig.shardSeconds <= 0 || totalSeconds <= m_timeConfig.shardSeconds) {
+        shards.append({ m_timeConfig.startTime, m_timeConfig.endTime });
+        return shards;
     }
 
-    // 时间范围查询
-    QDateTime current = m_timeConfig.startTime;
-    qint64 totalSeconds = m_timeConfig.startTime.secsTo(m_timeConfig.endTime);
-    int estimatedSize = totalSeconds / m_timeConfig.intervalSeconds + 1;
-    result.reserve(estimatedSize);
+    // 分片长度向上取整为采样间隔的整数倍，保证各分片的采样点落在同一网格上
+    const qint64 shardSpan = ((qint64)m_timeConfig.shardSeconds + interval - 1) / interval * interval;
 
-    while (current <= m_timeConfig.endTime) {
-        result.append(current);
-        current = current.addSecs(m_timeConfig.intervalSeconds);
+    // 相邻分片共享边界时刻；重复的边界采样在对齐时按“最近点”规则自然去重
+    QDateTime shardStart = m_timeConfig.startTime;
+    while (shardStart < m_timeConfig.endTime) {
+        QDateTime shardEnd = shardStart.addSecs(shardSpan);
+        if (shardEnd > m_timeConfig.endTime) {
+            shardEnd = m_timeConfig.endTime;
+        }
+        shards.append({ shardStart, shardEnd });
+        shardStart = shardEnd;
     }
 
-    return result;
+    return shards;
 }
 
-QHash<QString, QVector<double>> UnifiedQueryParser::alignData(
-    const std::map<int64_t, std::vector<float>>& rawData,
-    const QVector<QDateTime>& timeAxis)  // ← 新增参数
+void UnifiedQueryParser::fetchShard(const QString& queryAddr, ShardChannel* channel)
 {
-    qDebug() << "========== 开始数据对齐 ==========";
+    if (m_cancelRequested.loadAcquire() || channel->aborted()) {
+        channel->finish(false, QString());
+        return;
+    }
 
-    QHash<QString, QVector<double>> result;
-    QStringList rtuList;
-    int matchCount = 0;
-    int totalPoints = 0;
+    bool completed = false;
+    QString error;
+    try {
+        // 查询器每次读取从连接池借出独立句柄，可在分片线程间共享
+        completed = m_fetcher->fetchStreaming(queryAddr.toStdString(),
+            [this, channel](const TaosColumnarData& chunk) {
+                return channel->push(chunk) && !m_cancelRequested.loadAcquire();
+            });
+    }
+    catch (const std::exception& e) {
+        error = QString::fromUtf8(e.what());
+    }
 
-    int64_t toleranceMs = 0;
+    channel->finish(completed, error);
+}
 
-    // 初始化结果集
-    for (const auto& col : m_config.columns) {
-        rtuList.append(col.rtuId);
-        result[col.rtuId] = QVector<double>(timeAxis.size(), std::numeric_limits<double>::quiet_NaN());
-        qDebug() << QString("  初始化RTU: %1").arg(col.rtuId);
+bool UnifiedQueryParser::runShardedQuery(const QVector<ShardRange>& shards, AlignState& state)
+{
+    const int concurrency = qMax(1, m_timeConfig.shardConcurrency);
+    qDebug() << QString("分片查询：%1 个分片，并发 %2").arg(shards.size()).arg(concurrency);
+
+    // 声明顺序保证线程池先于分段队列析构（析构时等待所有分片结束）；
+    // 已拼接分片的队列为空，保留到最后统一释放
+    std::vector<std::unique_ptr<ShardChannel>> channels(shards.size());
+    QThreadPool shardPool;
+    shardPool.setMaxThreadCount(concurrency);
+
+    // 同时在途的分片不超过并发数：第 k 个分片拼接完成后才提交第 k+concurrency 个
+    int submitted = 0;
+    auto submitNext = [&]() {
+        if (submitted >= shards.size()) {
+            return;
+        }
+        ShardChannel* channel = new ShardChannel();
+        channels[submitted].reset(channel);
+        QString queryAddr = buildQueryAddress(shards[submitted].startTime, shards[submitted].endTime);
+        QtConcurrent::run(&shardPool, [this, queryAddr, channel]() {
+            fetchShard(queryAddr, channel);
+        });
+        submitted++;
+    };
+    while (submitted < qMin(concurrency, shards.size())) {
+        submitNext();
     }
 
-    // 容错窗口
-    if (m_timeConfig.intervalSeconds == 0) {
-        toleranceMs = 10000;  // 10秒
+    // 按时间顺序拼接：逐段取出第 k 个分片的数据对齐，其后的分片同时在读取并缓冲少量分段
+    QString shardError;
+    int stitchedCount = 0;
+    for (int k = 0; k < shards.size(); ++k) {
+        emit queryStageChanged(QString("正在对齐分片 %1/%2...").arg(k + 1).arg(shards.size()));
+
+        ShardChannel* channel = channels[k].get();
+        TaosColumnarData chunk;
+        while (channel->pop(chunk)) {
+            alignChunk(state, chunk);
+        }
+
+        shardError = channel->error();
+        if (!shardError.isEmpty() || !channel->completed() || m_cancelRequested.loadAcquire()) {
+            break;
+        }
+
+        stitchedCount++;
+        submitNext();
     }
-    else {
-        toleranceMs = (int64_t)(m_timeConfig.intervalSeconds * 1000);
+
+    // 出错或取消时通知尚未完成的分片尽快退出
+    for (const auto& channel : channels) {
+        if (channel) {
+            channel->abort();
+        }
     }
-    if (rawData.empty()) {
-        qWarning() << "原始数据为空！";
-        return result;
+    shardPool.waitForDone();
+
+    if (!shardError.isEmpty()) {
+        throw std::runtime_error(shardError.toStdString());
     }
 
-    // 检测时间戳单位
-    auto firstTs = rawData.begin()->first;
-    QDateTime testDt1 = QDateTime::fromSecsSinceEpoch(firstTs);
-    QDateTime testDt2 = QDateTime::fromMSecsSinceEpoch(firstTs);
+    return stitchedCount == shards.size() && !m_cancelRequested.loadAcquire();
+}
 
+TimeAxis UnifiedQueryParser::generateTimeAxis()
+{
+    if (!m_timeConfig.isValid()) {
+        qWarning() << "时间配置无效";
+        return TimeAxis();
+    }
 
-    bool isMilliseconds = (testDt2.date().year() >= 2000 && testDt2.date().year() <= 2100);
-    bool isSeconds = (testDt1.date().year() >= 2000 && testDt1.date().year() <= 2100);
+    // 隐式时间轴：不再逐点构造 QDateTime，显示时按需格式化
+    return TimeAxis::fromConfig(m_timeConfig);
+}
 
-    // 3. 遍历时间轴，对齐数据
-    for (int i = 0; i < timeAxis.size(); ++i) {  // ← 使用参数
-        if (m_cancelRequested.loadAcquire()) {
-            break;
-        }
+void UnifiedQueryParser::beginAlign(AlignState& state, const TimeAxis& timeAxis)
+{
+    qDebug() << "========== 开始数据对齐 ==========";
 
-        if (i > 0 && i % 100 == 0) {
-            emit queryProgressUpdated(i, timeAxis.size());
-        }
+    // 初始化结果集（部分快照与查询线程共享，之后只通过列指针写入）
+    state.timeAxis = timeAxis;
+    state.result = std::make_shared<AlignedDataMap>();
+    for (const auto& col : m_config.columns) {
+        (*state.result)[col.rtuKey] = QVector<double>(timeAxis.size(), std::numeric_limits<double>::quiet_NaN());
+        qDebug() << QString("  初始化RTU: %1").arg(col.rtuId);
+    }
 
-        int64_t targetTimeMs = timeAxis[i].toMSecsSinceEpoch();
-        int64_t targetTimeForCompare = isMilliseconds ? targetTimeMs : (targetTimeMs / 1000);
+    // 结果集初始化完成后一次性解析列指针（按查询列顺序），内层循环不再做哈希查找
+    // 注：同一RTU配置多列时共享同一数据向量，与原按字符串键写入的行为一致
+    QVector<double*> columnPtrs;
+    columnPtrs.reserve(m_config.columns.size());
+    for (const auto& col : m_config.columns) {
+        columnPtrs.append((*state.result)[col.rtuKey].data());
+    }
 
-        // 查找最接近的时间戳
-        int64_t closestTime = -1;
-        int64_t minDiff = LLONG_MAX;
+    std::vector<int64_t> axisMs = timeAxis.toMsVector();
 
-        for (auto it = rawData.begin(); it != rawData.end(); ++it) {
-            int64_t dbTime = it->first;
-            int64_t diff = isMilliseconds
-                ? qAbs(dbTime - targetTimeForCompare)
-                : qAbs((dbTime * 1000) - targetTimeMs);
+    // 容错窗口
+    int64_t toleranceMs = 0;
+    if (m_timeConfig.intervalSeconds == 0) {
+        toleranceMs = 10000;  // 10秒
+    }
+    else {
+        toleranceMs = (int64_t)(m_timeConfig.intervalSeconds * 1000);
+    }
 
-            if (diff < minDiff) {
-                minDiff = diff;
-                closestTime = dbTime;
-            }
-        }
+    state.aligner.begin(m_timeConfig.alignPolicy, std::move(axisMs), toleranceMs, columnPtrs,
+        &m_cancelRequested);
+    state.publishedRows = 0;
+    state.publishTimer.start();
+}
 
-        // 判断是否在容错范围内
-        if (closestTime != -1 && minDiff <= toleranceMs) {
-            const std::vector<float>& values = rawData.at(closestTime);
-
-            if (i < 3) {
-            }
-
-            if (rtuList.size() != (int)values.size()) {
-                qWarning() << QString("   RTU数量不匹配！配置=%1, 数据=%2")
-                    .arg(rtuList.size()).arg(values.size());
-            }
-
-            for (int j = 0; j < rtuList.size() && j < (int)values.size(); ++j) {
-                float rawValue = values[j];
-
-                if (std::isnan(rawValue) || std::isinf(rawValue)) {
-                    result[rtuList[j]][i] = std::numeric_limits<double>::quiet_NaN();
-                    if (i < 3) {
-                    }
-                }
-                else {
-                    result[rtuList[j]][i] = static_cast<double>(rawValue);
-                    if (i < 3) {
-                    }
-                }
-            }
-
-            matchCount++;
-        }
-        else {
-            if (i < 3) {
-                qDebug() << QString("   超出容错范围");
-            }
-        }
+void UnifiedQueryParser::alignChunk(AlignState& state, const TaosColumnarData& chunk)
+{
+    if (chunk.empty()) {
+        return;
+    }
 
-        totalPoints++;
+    const int columnCount = m_config.columns.size();
+    if (columnCount != (int)chunk.columnCount() && !state.columnMismatchReported) {
+        qWarning() << QString("   RTU数量不匹配！配置=%1, 数据=%2")
+            .arg(columnCount).arg(chunk.columnCount());
+        state.columnMismatchReported = true;
     }
 
-    if (!m_cancelRequested.loadAcquire()) {
-        emit queryProgressUpdated(timeAxis.size(), timeAxis.size());
+    // 时间戳已在获取边界统一为毫秒且升序，与时间轴做一次归并
+    state.aligner.feed(chunk);
+
+    // 进度按已被数据覆盖的时间轴点数计算
+    const std::vector<int64_t>& axisMs = state.aligner.axis();
+    int covered = std::upper_bound(axisMs.begin(), axisMs.end(),
+        chunk.timestamps.back()) - axisMs.begin();
+    emit queryProgressUpdated(covered, (int)axisMs.size());
+
+    // 分段（流式分块或按序拼接的分片）按时间顺序到达，本段末尾时间戳即为水位线
+    const int settled = state.aligner.settle(chunk.timestamps.back());
+    if (settled > state.publishedRows &&
+        (state.publishedRows == 0 || state.publishTimer.elapsed() >= kPartialPublishIntervalMs)) {
+        publishResult(buildResult(state, false));
+        state.publishedRows = settled;
+        state.publishTimer.restart();
     }
+}
+
+UnifiedQueryResultPtr UnifiedQueryParser::buildResult(const AlignState& state, bool complete) const
+{
+    auto result = std::make_shared<UnifiedQueryResult>();
+    result->timeAxis = state.timeAxis;
+    result->columns = m_config.columns;
+    result->alignedData = state.result;
+    result->readyRows = complete ? state.timeAxis.size() : state.aligner.settledCount();
+    result->complete = complete;
+    result->columnData.reserve(result->columns.size());
+    for (int j = 0; j < result->columns.size(); ++j) {
+        const int rtuKey = result->columns[j].rtuKey;
+        if (complete) {
+            result->columnStats.insert(rtuKey, state.aligner.stats(j));
+        }
 
+        auto colIt = state.result->constFind(rtuKey);
+        result->columnData.append(colIt != state.result->constEnd() ? &colIt.value() : nullptr);
+    }
     return result;
-}
\ No newline at end of file
+}
@@ -4,6 +4,52 @@
 
 #include "BaseReportParser.h"
 #include "DataBindingConfig.h"
+#include "TaosDataFetcher.h"
+#include "DataAligner.h"
+#include "TimeAxis.h"
+
+#include <QElapsedTimer>
+#include <memory>
+
+typedef QHash<int, QVector<double>> AlignedDataMap;    // 对齐后的数据（RTU整数键）
+
+/**
+ * @brief 统一查询结果快照
+ * 发布后只读；读取方持有引用计数指针，无需加锁。
+ * 查询过程中会陆续发布部分快照：同一次查询的各快照共享同一组列缓冲，
+ * 只有前 readyRows 行已定稿可读，之后的行仍在由查询线程写入。
+ */
+struct UnifiedQueryResult
+{
+    TimeAxis timeAxis;                                  // 时间轴
+    QList<ReportColumnConfig> columns;                  // 发布时的列配置
+    std::shared_ptr<const AlignedDataMap> alignedData;  // 对齐结果（与查询线程共享，只读前 readyRows 行）
+    QHash<int, DataAligner::ColumnStats> columnStats;   // 各列统计（RTU整数键，仅完整结果有效）
+    QVector<const QVector<double>*> columnData;         // 与 columns 一一对应，缺失时为空指针
+    int readyRows = 0;                                  // 已定稿的行数
+    bool complete = false;                              // 查询是否已全部完成
+
+    UnifiedQueryResult() = default;
+    UnifiedQueryResult(const UnifiedQueryResult&) = delete;             // columnData 指向自身数据，禁止拷贝
+    UnifiedQueryResult& operator=(const UnifiedQueryResult&) = delete;
+
+    bool isEmpty() const { return timeAxis.isEmpty(); }
+
+    /**
+     * @brief 与 other 是否属于同一次查询（共享列缓冲）
+     */
+    bool sharesDataWith(const UnifiedQueryResult& other) const {
+        return alignedData && alignedData == other.alignedData;
+    }
+
+    /**
+     * @brief 第 index 个数据列（越界或缺失时为空指针）
+     */
+    const QVector<double>* column(int index) const {
+        return (index >= 0 && index < columnData.size()) ? columnData[index] : nullptr;
+    }
+};
+typedef std::shared_ptr<const UnifiedQueryResult> UnifiedQueryResultPtr;
 
 class UnifiedQueryParser : public BaseReportParser
 {
@@ -21,8 +67,11 @@ public:
     // ===== 统一查询特有接口 =====
     void setTimeRange(const TimeRangeConfig& config);
     const HistoryReportConfig& getConfig() const { return m_config; }
-    const QVector<QDateTime>& getTimeAxis() const;
-    const QHash<QString, QVector<double>>& getAlignedData() const;
+
+    /**
+     * @brief 当前发布的查询结果（从不为空，尚未查询时为空快照；任意线程可调用）
+     */
+    UnifiedQueryResultPtr getResult() const;
 
     int getQueryIntervalSeconds() const override { return m_timeConfig.intervalSeconds; }
 
@@ -33,42 +82,68 @@ signals:
     // 查询进度信号（在后台线程中发射，主线程接收）
     void queryProgressUpdated(int current, int total);
     void queryStageChanged(const QString& stage);  // 查询阶段变化
+    void resultPublished();                         // 新的结果快照（含查询中的部分结果）已发布（在后台线程中发射）
 
 protected:
-    bool runAsyncTask() override;
+    bool runAsyncTask(const PrefetchPlanPtr& plan) override;
 
     // ===== 实现纯虚函数（统一查询不需要这些）=====
     bool findDateMarker() override { return true; }
-    void parseRow(int row) override { Q_UNUSED(row); }
+    void parseRow(int row, const RowScan& scan) override { Q_UNUSED(row); Q_UNUSED(scan); }
     QTime getTaskTime(const QueryTask& task) override { Q_UNUSED(task); return QTime(); }
     QDateTime constructDateTime(const QString& date, const QString& time) override {
         Q_UNUSED(date); Q_UNUSED(time); return QDateTime();
     }
 
 
-    bool analyzeAndPrefetch() override { return true; }  // 空实现
+    bool analyzeAndPrefetch(const PrefetchPlan& plan) override { Q_UNUSED(plan); return true; }  // 空实现
     QList<TimeBlock> identifyTimeBlocks() override { return QList<TimeBlock>(); }  // 空实现
 
     QString findTimeForDataMarker(int row, int col) override { return ""; }// 纯虚函数，子类实现
 
     QString extractTime(const QString& text) const override { return ""; }
+    bool resolveTimeMarker(const QString& markerText, QString& value) const override {
+        Q_UNUSED(markerText); Q_UNUSED(value); return false;
+    }
+    int64_t resolveTaskTimestamp(const QueryTask& task) const override {
+        Q_UNUSED(task); return -1;
+    }
 
 private:
     HistoryReportConfig m_config;           // 配置信息
     TimeRangeConfig m_timeConfig;           // 时间配置
-    QVector<QDateTime> m_timeAxis;          // 时间轴
-    QHash<QString, QVector<double>> m_alignedData;  // 对齐后的数据
-
-    mutable QMutex m_dataMutex;
+    UnifiedQueryResultPtr m_result;         // 已发布的结果快照，通过 std::atomic_load/atomic_store 访问
 
 private:
     // ===== 私有辅助函数 =====
     bool loadConfigFromCells();
-    QString buildQueryAddress();
-    QVector<QDateTime> generateTimeAxis();
-    QHash<QString, QVector<double>> alignData(
-        const std::map<int64_t, std::vector<float>>& rawData,
-        const QVector<QDateTime>& timeAxis);
+    void publishResult(const UnifiedQueryResultPtr& result);
+    bool runQuery();
+    QString buildQueryAddress(const QDateTime& startTime, const QDateTime& endTime);
+    TimeAxis generateTimeAxis();
+
+    // 流式对齐状态：逐段接收数据，按报表选择的策略归并到时间轴
+    struct AlignState {
+        TimeAxis timeAxis;
+        std::shared_ptr<AlignedDataMap> result; // 对齐结果（RTU整数键），开始对齐后不再增删键或改变长度
+        DataAligner aligner;                    // 写入 result 中按查询列顺序解析的列
+        bool columnMismatchReported = false;
+        int publishedRows = 0;                  // 已随部分快照发布的行数
+        QElapsedTimer publishTimer;             // 距上次发布部分快照的时间
+    };
+    void beginAlign(AlignState& state, const TimeAxis& timeAxis);
+    void alignChunk(AlignState& state, const TaosColumnarData& chunk);
+    UnifiedQueryResultPtr buildResult(const AlignState& state, bool complete) const;
+
+    // ===== 分片并发查询 =====
+    struct ShardRange {
+        QDateTime startTime;
+        QDateTime endTime;
+    };
+    class ShardChannel;     // 分片到拼接线程的有界分段队列
+    QVector<ShardRange> planShards() const;
+    void fetchShard(const QString& queryAddr, ShardChannel* channel);
+    bool runShardedQuery(const QVector<ShardRange>& shards, AlignState& state);
 };
 
 #endif // UNIFIEDQUERYPARSER_H
\ No newline at end of file
@@ -279,8 +279,12 @@ bool ExcelHandler::saveToFile(const QString& fileName, ReportDataModel* model, E
             cell->style.font.pointSize() == defaultStyle.font.pointSize() &&
             cell->style.font.bold() == defaultStyle.font.bold();
 
+        // 原始精度的数值结果需要数字格式保持两位小数显示
+        const bool typedNumber = (mode == EXPORT_DATA && cell->cellValue.isNumber() &&
+            valueToWrite.type() == QVariant::Double);
+
         // 只有在单元格样式为默认，且没有合并单元格时，才不写入格式对象
-        if (isTrulyDefault && !cell->mergedRange.isMerged())
+        if (isTrulyDefault && !cell->mergedRange.isMerged() && !typedNumber)
         {
             // 样式完全是默认的，不传入 Format 对象，Excel 将显示默认网格线
             worksheet->write(excelRow, excelCol, valueToWrite);
@@ -290,6 +294,9 @@ bool ExcelHandler::saveToFile(const QString& fileName, ReportDataModel* model, E
             // 样式非默认（例如有边框、背景色、或非默认字体等），或者它是合并单元格的主单元格。
             // 必须写入 Format 对象。
             QXlsx::Format cellFormat = convertToExcelFormat(cell->style);
+            if (typedNumber) {
+                cellFormat.setNumberFormat("0.00");
+            }
             worksheet->write(excelRow, excelCol, valueToWrite, cellFormat);
         }
 
@@ -616,15 +623,17 @@ QVariant ExcelHandler::getCellValueForExport(const CellData* cell, ExportMode mo
         // ===== 导出数据模式 =====
         // 1. 如果是已计算的公式，返回计算结果 (存储在 displayValue 中)
         if (cell->hasFormula && cell->formulaCalculated) {
-            // 注意：这里假设公式计算结果存在 displayValue 中
-            // 如果存在 value，需要确认哪个是最新的
-            return cell->displayValue;
+            // 数值结果按原始精度导出（两位小数由单元格数字格式显示）
+            return cell->cellValue.isNumber() ? QVariant(cell->cellValue.number) : cell->displayValue;
         }
         // 2. 如果是数据标记 (#d#)
         else if (cell->cellType == CellData::DataMarker) {
             // 如果查询成功，返回填充的数据 (存储在 displayValue 中)
             // 如果查询失败或未执行，返回 "N/A"
-            return cell->queryExecuted && cell->querySuccess ? cell->displayValue : QVariant("N/A");
+            if (!cell->queryExecuted || !cell->querySuccess) {
+                return QVariant("N/A");
+            }
+            return cell->cellValue.isNumber() ? QVariant(cell->cellValue.number) : cell->displayValue;
         }
         // 3. 其他情况 (普通文本、数字、未计算公式、其他标记 #t# #Date#)
         else {
@@ -3,6 +3,7 @@
 #include <QRegularExpression>
 #include <QStack>
 #include <QQueue>
+#include <QVarLengthArray>
 #include <qDebug>
 #include <limits>
 
@@ -10,319 +11,366 @@ FormulaEngine::FormulaEngine(QObject* parent) : QObject(parent)
 {
 }
 
-QVariant FormulaEngine::evaluate(const QString& formula, ReportDataModel* model, int currentRow, int currentCol)
-{
-    Q_UNUSED(currentRow)
-        Q_UNUSED(currentCol)
-
-    if (!isFormula(formula))
-        return formula;
+namespace {
 
-    // ===== 处理延迟公式 #=# =====
-    QString expr;
-    if (formula.startsWith("#=#")) {
-        expr = formula.mid(3).trimmed();  // 去掉 "#=#" 前缀
-    }
-    else if (formula.startsWith('=')) {
-        expr = formula.mid(1).trimmed();   // 去掉 "=" 前缀
-    }
-    else {
-        return formula;  // 既不是 = 也不是 #=#，返回原值
+// 递归下降解析四则运算表达式，直接生成后缀指令：
+//   expression := term (('+' | '-') term)*
+//   term       := unary (('*' | '/') unary)*
+//   unary      := ('+' | '-') unary | primary
+//   primary    := 数字 | 单元格引用 | '(' expression ')'
+class ExpressionCompiler
+{
+public:
+    ExpressionCompiler(const QString& text, QVector<CompiledFormula::Instruction>& program)
+        : m_text(text), m_pos(0), m_depth(0), m_maxDepth(0), m_program(program) {}
+
+    bool compile()
+    {
+        if (!parseExpression()) {
+            return false;
+        }
+        skipSpaces();
+        return m_pos == m_text.length() && m_depth == 1;
     }
 
-    QRegularExpression functionRegex(R"(^(SUM|MAX|MIN)\s*\([^)]+\)$)");
-    QRegularExpressionMatch functionMatch = functionRegex.match(expr);
-
-    if (functionMatch.hasMatch()) {
-        // 处理函数
-        if (expr.startsWith("SUM")) {
-            QRegularExpression sumRegex(R"(SUM\s*\(([A-Z]+\d+:[A-Z]+\d+)\))");
-            QRegularExpressionMatch match = sumRegex.match(expr);
-            if (match.hasMatch()) {
-                return evaluateSum(match.captured(1), model);
+    int maxDepth() const { return m_maxDepth; }
+
+private:
+    bool parseExpression()
+    {
+        if (!parseTerm()) return false;
+        for (;;) {
+            skipSpaces();
+            if (peek() == '+' || peek() == '-') {
+                const QChar op = m_text[m_pos++];
+                if (!parseTerm()) return false;
+                emitOp(op == '+' ? CompiledFormula::Add : CompiledFormula::Subtract);
             }
-        }
-        else if (expr.startsWith("MAX")) {
-            QRegularExpression maxRegex(R"(MAX\s*\(([A-Z]+\d+:[A-Z]+\d+)\))");
-            QRegularExpressionMatch match = maxRegex.match(expr);
-            if (match.hasMatch()) {
-                return evaluateMax(match.captured(1), model);
+            else {
+                return true;
             }
         }
-        else if (expr.startsWith("MIN")) {
-            QRegularExpression minRegex(R"(MIN\s*\(([A-Z]+\d+:[A-Z]+\d+)\))");
-            QRegularExpressionMatch match = minRegex.match(expr);
-            if (match.hasMatch()) {
-                return evaluateMin(match.captured(1), model);
+    }
+
+    bool parseTerm()
+    {
+        if (!parseUnary()) return false;
+        for (;;) {
+            skipSpaces();
+            if (peek() == '*' || peek() == '/') {
+                const QChar op = m_text[m_pos++];
+                if (!parseUnary()) return false;
+                emitOp(op == '*' ? CompiledFormula::Multiply : CompiledFormula::Divide);
+            }
+            else {
+                return true;
             }
         }
     }
 
-    // 如果不是函数，尝试作为表达式处理
-    return evaluateExpression(expr, model);
-}
-
-bool FormulaEngine::isFormula(const QString& text) const
-{
-    return !text.isEmpty() && (text.startsWith('=') || text.startsWith("#=#"));
-}
-
-// 
-QVariant FormulaEngine::evaluateSum(const QString& range, ReportDataModel* model)
-{
-    QPair<QPoint, QPoint> cellRange = parseRange(range);
-    if (cellRange.first.x() == -1 || cellRange.second.x() == -1) {
-        return QVariant("N/A");  //  改为返回 N/A
+    bool parseUnary()
+    {
+        skipSpaces();
+        if (peek() == '+') {
+            m_pos++;
+            return parseUnary();
+        }
+        if (peek() == '-') {
+            m_pos++;
+            if (!parseUnary()) return false;
+            m_program.append({ CompiledFormula::Negate, 0, 0, 0.0 });
+            return true;
+        }
+        return parsePrimary();
     }
 
-    double sum = 0.0;
-    int validCount = 0;  // 记录有效值数量
-    bool ok;
+    bool parsePrimary()
+    {
+        skipSpaces();
+        const QChar c = peek();
+
+        if (c == '(') {
+            m_pos++;
+            if (!parseExpression()) return false;
+            skipSpaces();
+            if (peek() != ')') return false;
+            m_pos++;
+            return true;
+        }
 
-    for (int row = cellRange.first.x(); row <= cellRange.second.x(); ++row) {
-        for (int col = cellRange.first.y(); col <= cellRange.second.y(); ++col) {
-            QVariant cellVal = model->getCellValueForFormula(row, col);
+        if (c.isDigit() || c == '.') {
+            const int start = m_pos;
+            while (m_pos < m_text.length() && (m_text[m_pos].isDigit() || m_text[m_pos] == '.')) {
+                m_pos++;
+            }
+            bool ok = false;
+            const double number = m_text.midRef(start, m_pos - start).toDouble(&ok);
+            if (!ok) return false;
+            push({ CompiledFormula::PushNumber, 0, 0, number });
+            return true;
+        }
 
-            // 跳过 N/A 值
-            if (cellVal.toString() == "N/A") {
-                continue;
+        if (c >= 'A' && c <= 'Z') {
+            // 单元格引用：列字母 + 行号（1基），编译时转换为0基坐标
+            int col = 0;
+            while (m_pos < m_text.length() && m_text[m_pos] >= 'A' && m_text[m_pos] <= 'Z') {
+                col = col * 26 + (m_text[m_pos].unicode() - 'A' + 1);
+                m_pos++;
+            }
+            const int digitStart = m_pos;
+            while (m_pos < m_text.length() && m_text[m_pos].isDigit()) {
+                m_pos++;
             }
+            if (m_pos == digitStart) return false;
 
-            double value = cellVal.toDouble(&ok);
-            if (ok) {
-                sum += value;
-                validCount++;
+            const int row = m_text.midRef(digitStart, m_pos - digitStart).toInt() - 1;
+            if (row < 0) {
+                push({ CompiledFormula::PushNumber, 0, 0, 0.0 });   // 第0行视为 0
             }
+            else {
+                push({ CompiledFormula::PushCell, row, col - 1, 0.0 });
+            }
+            return true;
         }
+
+        return false;
     }
 
-    // 如果所有值都是 N/A，返回 N/A
-    if (validCount == 0) {
-        return QVariant("N/A");
+    void push(const CompiledFormula::Instruction& instruction)
+    {
+        m_program.append(instruction);
+        m_maxDepth = qMax(m_maxDepth, ++m_depth);
     }
 
-    return QString::number(sum, 'f', 2);
-}
+    void emitOp(CompiledFormula::OpCode op)
+    {
+        m_program.append({ op, 0, 0, 0.0 });
+        m_depth--;
+    }
 
-QVariant FormulaEngine::evaluateMax(const QString& range, ReportDataModel* model)
-{
-    QPair<QPoint, QPoint> cellRange = parseRange(range);
-    if (cellRange.first.x() == -1 || cellRange.second.x() == -1) {
-        return QVariant("N/A");  // 改为返回 N/A
+    void skipSpaces()
+    {
+        while (m_pos < m_text.length() && m_text[m_pos].isSpace()) {
+            m_pos++;
+        }
     }
 
-    double maxValue = -std::numeric_limits<double>::infinity();
-    bool hasNumericValue = false;
-    bool ok;
+    QChar peek() const { return m_pos < m_text.length() ? m_text[m_pos] : QChar(); }
 
-    for (int row = cellRange.first.x(); row <= cellRange.second.x(); ++row) {
-        for (int col = cellRange.first.y(); col <= cellRange.second.y(); ++col) {
-            QVariant cellVal = model->getCellValueForFormula(row, col);
+    const QString& m_text;
+    int m_pos;
+    int m_depth;
+    int m_maxDepth;
+    QVector<CompiledFormula::Instruction>& m_program;
+};
 
-            // 跳过 N/A 值
-            if (cellVal.toString() == "N/A") {
-                continue;
-            }
+} // namespace
 
-            double value = cellVal.toDouble(&ok);
-            if (ok) {
-                if (!hasNumericValue || value > maxValue) {
-                    maxValue = value;
-                }
-                hasNumericValue = true;
-            }
-        }
-    }
+CellValue FormulaEngine::evaluate(const QString& formula, ReportDataModel* model, int currentRow, int currentCol)
+{
+    return run(compiled(formula, currentRow, currentCol), model);
+}
 
-    // 如果所有值都是 N/A，返回 N/A
-    return hasNumericValue ? QString::number(maxValue, 'f', 2) : QVariant("N/A");
+bool FormulaEngine::isFormula(const QString& text) const
+{
+    return !text.isEmpty() && (text.startsWith('=') || text.startsWith("#=#"));
 }
 
-QVariant FormulaEngine::evaluateMin(const QString& range, ReportDataModel* model)
+const CompiledFormula& FormulaEngine::compiled(const QString& formula, int row, int col)
 {
-    QPair<QPoint, QPoint> cellRange = parseRange(range);
-    if (cellRange.first.x() == -1 || cellRange.second.x() == -1) {
-        return QVariant("N/A");  //  改为返回 N/A
+    const QPoint key(row, col);
+    auto it = m_cache.find(key);
+    if (it == m_cache.end()) {
+        it = m_cache.insert(key, CacheEntry{ formula, compile(formula) });
     }
-
-    double minValue = std::numeric_limits<double>::infinity();
-    bool hasNumericValue = false;
-    bool ok;
-
-    for (int row = cellRange.first.x(); row <= cellRange.second.x(); ++row) {
-        for (int col = cellRange.first.y(); col <= cellRange.second.y(); ++col) {
-            QVariant cellVal = model->getCellValueForFormula(row, col);
-
-            //  跳过 N/A 值
-            if (cellVal.toString() == "N/A") {
-                continue;
-            }
-
-            double value = cellVal.toDouble(&ok);
-            if (ok) {
-                if (!hasNumericValue || value < minValue) {
-                    minValue = value;
-                }
-                hasNumericValue = true;
-            }
-        }
+    else if (it->formula != formula) {
+        // 公式文本已修改，重新编译
+        it->formula = formula;
+        it->compiled = compile(formula);
     }
-
-    //  如果所有值都是 N/A，返回 N/A
-    return hasNumericValue ? QString::number(minValue, 'f', 2) : QVariant("N/A");
+    return it->compiled;
 }
 
-QVariant FormulaEngine::evaluateExpression(const QString& expression, ReportDataModel* model)
+void FormulaEngine::clearCache()
 {
-    // 1. 预处理：将单元格引用替换为实际值
-    QString processedExpr = preprocessExpression(expression, model);
-
-    // 2. 计算算术表达式
-    return calculateArithmetic(processedExpr);
+    m_cache.clear();
 }
 
-QString FormulaEngine::preprocessExpression(const QString& expression, ReportDataModel* model)
+CompiledFormula FormulaEngine::compile(const QString& formula) const
 {
-    QString result = expression;
+    CompiledFormula result;
 
-    // 匹配单元格引用（如A1, B2, AA10等）
-    QRegularExpression cellRefRegex(R"([A-Z]+\d+)");
-    QRegularExpressionMatchIterator it = cellRefRegex.globalMatch(expression);
-
-    // 从后往前替换，避免位置偏移
-    QList<QRegularExpressionMatch> matches;
-    while (it.hasNext()) {
-        matches.append(it.next());
+    if (!isFormula(formula)) {
+        result.kind = CompiledFormula::Literal;
+        return result;
     }
 
-    for (int i = matches.size() - 1; i >= 0; --i) {
-        const QRegularExpressionMatch& match = matches[i];
-        QString cellRef = match.captured(0);
-        QVariant cellValue = getCellValue(cellRef, model);
-
-        // 将单元格值转换为数字字符串
-        bool ok;
-        double numValue = cellValue.toDouble(&ok);
-        if (!ok) {
-            // 检查是否是 N/A
-            if (cellValue.toString() == "N/A") {
-                result.replace(match.capturedStart(), match.capturedLength(), "N/A");
-                continue;  // 跳过这个替换，保留 N/A
-            }
-            numValue = 0.0; // 如果不是数字，当作0处理
-        }
+    // ===== 处理延迟公式 #=# =====
+    QString expr;
+    if (formula.startsWith("#=#")) {
+        expr = formula.mid(3).trimmed();  // 去掉 "#=#" 前缀
+    }
+    else {
+        expr = formula.mid(1).trimmed();  // 去掉 "=" 前缀
+    }
 
-        result.replace(match.capturedStart(), match.capturedLength(), QString::number(numValue));
+    // 区域函数：SUM/MAX/MIN(A1:B3)，单个单元格视为 1×1 区域
+    static const QRegularExpression functionRegex(R"(^(SUM|MAX|MIN)\s*\(([A-Z]+\d+(?::[A-Z]+\d+)?)\)$)");
+    QRegularExpressionMatch functionMatch = functionRegex.match(expr);
+    if (functionMatch.hasMatch()) {
+        const QString name = functionMatch.captured(1);
+        const QString range = functionMatch.captured(2);
+        QPair<QPoint, QPoint> cellRange = range.contains(':')
+            ? parseRange(range) : qMakePair(parseReference(range), parseReference(range));
+
+        result.kind = CompiledFormula::RangeFunction;
+        result.function = (name == "SUM") ? CompiledFormula::Sum
+            : (name == "MAX") ? CompiledFormula::Max : CompiledFormula::Min;
+        result.rangeStart = cellRange.first;
+        result.rangeEnd = cellRange.second;
+        return result;
     }
 
+    // 如果不是函数，尝试作为表达式处理
+    if (compileExpression(expr, result)) {
+        result.kind = CompiledFormula::Expression;
+    }
+    else {
+        result.kind = CompiledFormula::Invalid;
+        result.program.clear();
+        qDebug() << "公式语法错误：" << formula;
+    }
     return result;
 }
 
-QVariant FormulaEngine::calculateArithmetic(const QString& expression)
+bool FormulaEngine::compileExpression(const QString& expression, CompiledFormula& result) const
 {
-    if (expression.contains("N/A", Qt::CaseInsensitive)) {
-        return QVariant("N/A");
+    ExpressionCompiler compiler(expression, result.program);
+    if (!compiler.compile()) {
+        return false;
     }
+    result.maxStackDepth = compiler.maxDepth();
+    return true;
+}
 
-    // 使用调度场算法（Shunting Yard Algorithm）计算表达式
-    QStack<double> numbers;
-    QStack<QChar> operators;
-
-    QString cleanExpr = expression;
-    cleanExpr.remove(' '); // 移除空格
+CellValue FormulaEngine::run(const CompiledFormula& formula, ReportDataModel* model) const
+{
+    switch (formula.kind) {
+    case CompiledFormula::Literal:
+        return CellValue();     // 无数值结果，显示文本由调用方保留
+    case CompiledFormula::RangeFunction:
+        return runRangeFunction(formula, model);
+    case CompiledFormula::Expression:
+        return runExpression(formula, model);
+    default:
+        return CellValue::fromError(CellValue::SyntaxError); // 表达式错误
+    }
+}
 
-    int i = 0;
-    while (i < cleanExpr.length()) {
-        QChar c = cleanExpr[i];
+CellValue FormulaEngine::runRangeFunction(const CompiledFormula& formula, ReportDataModel* model) const
+{
+    if (formula.rangeStart.x() == -1 || formula.rangeEnd.x() == -1) {
+        return CellValue::notAvailable();
+    }
 
-        if (c.isDigit() || c == '.') {
-            // 读取完整的数字
-            QString numStr;
-            while (i < cleanExpr.length() && (cleanExpr[i].isDigit() || cleanExpr[i] == '.')) {
-                numStr += cleanExpr[i];
-                i++;
-            }
-            numbers.push(numStr.toDouble());
-            continue;
-        }
-        else if (c == '(') {
-            operators.push(c);
-        }
-        else if (c == ')') {
-            while (!operators.isEmpty() && operators.top() != '(') {
-                QChar op = operators.pop();
-                if (numbers.size() < 2) return QVariant("#ERROR!"); // 错误
-                double right = numbers.pop();
-                double left = numbers.pop();
-                numbers.push(applyOperator(left, right, op));
-            }
-            if (!operators.isEmpty()) operators.pop(); // 移除 '('
+    // 区域所在列已建聚合索引时直接查询，无需逐格读取单元格
+    // SUM 按逐格顺序累加索引叶子，结果与是否走索引无关
+    if (formula.function == CompiledFormula::Sum) {
+        double sum = 0.0;
+        int count = 0;
+        if (model->sumRange(formula.rangeStart, formula.rangeEnd, sum, count)) {
+            return count > 0 ? CellValue::fromNumber(sum) : CellValue::notAvailable();
         }
-        else if (isOperator(c)) {
-            while (!operators.isEmpty() &&
-                operators.top() != '(' &&
-                getOperatorPrecedence(operators.top()) >= getOperatorPrecedence(c)) {
-                QChar op = operators.pop();
-                if (numbers.size() < 2) return QVariant("#ERROR!"); // 错误
-                double right = numbers.pop();
-                double left = numbers.pop();
-                numbers.push(applyOperator(left, right, op));
+    }
+    else {
+        RangeAggregateIndex::Aggregate aggregate;
+        if (model->aggregateRange(formula.rangeStart, formula.rangeEnd, aggregate)) {
+            if (aggregate.count == 0) {
+                return CellValue::notAvailable();
             }
-            operators.push(c);
+            return CellValue::fromNumber(formula.function == CompiledFormula::Max
+                ? aggregate.maxValue : aggregate.minValue);
         }
-
-        i++;
     }
 
-    // 处理剩余的操作符
-    while (!operators.isEmpty()) {
-        QChar op = operators.pop();
-        if (numbers.size() < 2) return QVariant("#ERROR!"); // 错误
-        double right = numbers.pop();
-        double left = numbers.pop();
-        numbers.push(applyOperator(left, right, op));
-    }
+    double result = 0.0;
+    bool hasNumericValue = false;  // 是否存在有效值
 
-    if (numbers.size() == 1) {
-        return QString::number(numbers.top(), 'f', 2);
-    }
-
-    return QVariant("#ERROR!"); // 表达式错误
-}
+    for (int row = formula.rangeStart.x(); row <= formula.rangeEnd.x(); ++row) {
+        for (int col = formula.rangeStart.y(); col <= formula.rangeEnd.y(); ++col) {
+            const CellValue cellVal = model->getCellValueForFormula(row, col);
 
-QVariant FormulaEngine::getCellValue(const QString& cellRef, ReportDataModel* model)
-{
-    QPoint pos = parseReference(cellRef);
-    if (pos.x() == -1 || pos.y() == -1) {
-        return QVariant(0.0);
+            // N/A 与非数值单元格均跳过
+            if (!cellVal.isNumber()) {
+                continue;
+            }
+            const double value = cellVal.number;
+
+            switch (formula.function) {
+            case CompiledFormula::Sum:
+                result = hasNumericValue ? result + value : value;
+                break;
+            case CompiledFormula::Max:
+                if (!hasNumericValue || value > result) result = value;
+                break;
+            case CompiledFormula::Min:
+                if (!hasNumericValue || value < result) result = value;
+                break;
+            }
+            hasNumericValue = true;
+        }
     }
 
-    return model->getCellValueForFormula(pos.x(), pos.y());
+    // 如果所有值都是 N/A，返回 N/A
+    return hasNumericValue ? CellValue::fromNumber(result) : CellValue::notAvailable();
 }
 
-double FormulaEngine::applyOperator(double left, double right, QChar op)
+CellValue FormulaEngine::runExpression(const CompiledFormula& formula, ReportDataModel* model) const
 {
-    switch (op.unicode()) {
-    case '+': return left + right;
-    case '-': return left - right;
-    case '*': return left * right;
-    case '/': return (right != 0) ? left / right : 0;
-    default: return 0;
+    QVarLengthArray<double, 32> stack(formula.maxStackDepth);
+    int top = 0;
+    bool hasNA = false;
+
+    for (const CompiledFormula::Instruction& ins : formula.program) {
+        switch (ins.op) {
+        case CompiledFormula::PushNumber:
+            stack[top++] = ins.number;
+            break;
+        case CompiledFormula::PushCell: {
+            const CellValue cellValue = model->getCellValueForFormula(ins.row, ins.col);
+            // N/A 使整个结果为 N/A，其他非数字当作0处理
+            if (cellValue.isNotAvailable()) {
+                hasNA = true;
+            }
+            stack[top++] = cellValue.isNumber() ? cellValue.number : 0.0;
+            break;
+        }
+        case CompiledFormula::Add:
+            top--;
+            stack[top - 1] += stack[top];
+            break;
+        case CompiledFormula::Subtract:
+            top--;
+            stack[top - 1] -= stack[top];
+            break;
+        case CompiledFormula::Multiply:
+            top--;
+            stack[top - 1] *= stack[top];
+            break;
+        case CompiledFormula::Divide:
+            top--;
+            stack[top - 1] = (stack[top] != 0) ? stack[top - 1] / stack[top] : 0;
+            break;
+        case CompiledFormula::Negate:
+            stack[top - 1] = -stack[top - 1];
+            break;
+        }
     }
-}
 
-int FormulaEngine::getOperatorPrecedence(QChar op)
-{
-    switch (op.unicode()) {
-    case '+': case '-': return 1;
-    case '*': case '/': return 2;
-    default: return 0;
+    if (hasNA) {
+        return CellValue::notAvailable();
     }
-}
-
-bool FormulaEngine::isOperator(QChar c)
-{
-    return c == '+' || c == '-' || c == '*' || c == '/';
+    return CellValue::fromNumber(stack[0]);
 }
 
 QPoint FormulaEngine::parseReference(const QString& ref) const
@@ -5,10 +5,56 @@
 #include <QVariant>
 #include <QString>
 #include <QStack>
+#include <QHash>
+#include <QPoint>
+#include <QVector>
 #include "DataBindingConfig.h"
 
 class ReportDataModel;
 
+/**
+ * @brief 编译后的公式
+ * 公式文本只解析一次：单元格引用在编译时解析为坐标，算术表达式转换为后缀指令序列，
+ * 求值时只做数值运算，不再拼接、重新扫描字符串。
+ */
+struct CompiledFormula
+{
+    enum Kind {
+        Literal,        // 非公式文本（无数值结果）
+        RangeFunction,  // SUM/MAX/MIN(区域)
+        Expression,     // 四则运算表达式
+        Invalid         // 语法错误，求值结果为 #ERROR!
+    };
+
+    enum OpCode {
+        PushNumber,     // 压入常量
+        PushCell,       // 压入单元格数值（N/A 时整个公式结果为 N/A，非数值按 0 计）
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Negate
+    };
+
+    struct Instruction {
+        OpCode op;
+        int row;        // PushCell：0基行号
+        int col;        // PushCell：0基列号
+        double number;  // PushNumber：常量值
+    };
+
+    enum Function { Sum, Max, Min };
+
+    Kind kind;
+    Function function;                  // RangeFunction：函数
+    QPoint rangeStart;                  // RangeFunction：区域左上角（行, 列）
+    QPoint rangeEnd;                    // RangeFunction：区域右下角（行, 列）
+    QVector<Instruction> program;       // Expression：后缀指令序列
+    int maxStackDepth;                  // Expression：求值所需的栈深度
+
+    CompiledFormula() : kind(Invalid), function(Sum), maxStackDepth(0) {}
+};
+
 class FormulaEngine : public QObject
 {
     Q_OBJECT
@@ -16,29 +62,50 @@ class FormulaEngine : public QObject
 public:
     explicit FormulaEngine(QObject* parent = nullptr);
 
-    QVariant evaluate(const QString& formula, ReportDataModel* model, int currentRow, int currentCol);
+    /**
+     * @brief 计算 (currentRow, currentCol) 处的公式
+     * 编译结果按单元格缓存，公式文本变化时才重新编译
+     * @return 类型化结果（数值保持原始精度，显示格式由调用方决定）；
+     *         非公式文本返回空值，调用方应保留其原文本作为显示
+     */
+    CellValue evaluate(const QString& formula, ReportDataModel* model, int currentRow, int currentCol);
     bool isFormula(const QString& text) const;
 
-private:
-    // 原有函数支持
-    QVariant evaluateSum(const QString& range, ReportDataModel* model);
-    QVariant evaluateMax(const QString& range, ReportDataModel* model);
-    QVariant evaluateMin(const QString& range, ReportDataModel* model);
+    /**
+     * @brief 取单元格的编译结果（命中缓存且文本一致时直接返回）
+     */
+    const CompiledFormula& compiled(const QString& formula, int row, int col);
+
+    /**
+     * @brief 对编译结果求值（只读，不修改缓存）
+     * Literal 返回空值（无数值结果），调用方保留原文本
+     */
+    CellValue run(const CompiledFormula& formula, ReportDataModel* model) const;
 
-    // 新增：表达式计算支持
-    QVariant evaluateExpression(const QString& expression, ReportDataModel* model);
-    QString preprocessExpression(const QString& expression, ReportDataModel* model);
-    QVariant calculateArithmetic(const QString& expression);
+    /**
+     * @brief 清空编译缓存（单元格整体重建时调用）
+     */
+    void clearCache();
+
+    /**
+     * @brief 将公式文本编译为指令序列
+     */
+    CompiledFormula compile(const QString& formula) const;
+
+private:
+    struct CacheEntry {
+        QString formula;                // 编译时的公式文本
+        CompiledFormula compiled;
+    };
+    QHash<QPoint, CacheEntry> m_cache;  // 按单元格（行, 列）缓存
 
-    // 操作符处理
-    double applyOperator(double left, double right, QChar op);
-    int getOperatorPrecedence(QChar op);
-    bool isOperator(QChar c);
+    bool compileExpression(const QString& expression, CompiledFormula& result) const;
+    CellValue runRangeFunction(const CompiledFormula& formula, ReportDataModel* model) const;
+    CellValue runExpression(const CompiledFormula& formula, ReportDataModel* model) const;
 
     // 单元格引用处理
     QPoint parseReference(const QString& ref) const;
     QPair<QPoint, QPoint> parseRange(const QString& range) const;
-    QVariant getCellValue(const QString& cellRef, ReportDataModel* model);
 
     // 工具函数
     bool isValidCellReference(const QString& ref) const;
@@ -1,9 +1,21 @@
 ﻿#include <QApplication>
+#include <QThread>
+#include <QSettings>
 #include "mainwindow.h"
+#include "TaosConnectionPool.h"
 
 int main(int argc, char* argv[]){
     QApplication app(argc, argv);
 
+    // 预热 TDengine 连接池：容量与预热数可在配置文件 [ConnectionPool] 中指定，
+    // 未配置时容量与并发查询线程数匹配，启动时先建立2个连接
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ScadaReportControl", "ConnectionPool");
+    settings.beginGroup("ConnectionPool");
+    const int poolSize = qMax(1, settings.value("maxSize", qBound(2, QThread::idealThreadCount(), 8)).toInt());
+    const int warmCount = qBound(0, settings.value("warmCount", 2).toInt(), poolSize);
+    settings.endGroup();
+    TaosConnectionPool::instance().initialize(poolSize, warmCount);
+
     MainWindow window;
     window.show();
 
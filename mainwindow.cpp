@@ -11,6 +11,7 @@
 #include <QFileInfo>
 #include <QDebug>
 #include <QShortcut>
+#include <QScrollBar>
 #include <QRegularExpression> 
 
 #include "mainwindow.h"
@@ -121,6 +122,8 @@ void MainWindow::setupTableView()
         this, &MainWindow::onCurrentCellChanged);
     connect(m_dataModel, &ReportDataModel::cellChanged,
         this, &MainWindow::onCellChanged);
+    connect(m_tableView->verticalScrollBar(), &QScrollBar::valueChanged,
+        this, &MainWindow::onViewportScrolled);
     connect(m_tableView, &QTableView::customContextMenuRequested,
         [this](const QPoint& pos) {
             m_contextMenu->exec(m_tableView->mapToGlobal(pos));
@@ -836,27 +839,13 @@ void MainWindow::onUnifiedQueryCompleted(bool success, QString message)
             m_dataModel->getParser());
         if (!parser) return;
 
-        // ===== 补充：更新 Model 尺寸 =====
-        const QVector<QDateTime>& timeAxis = parser->getTimeAxis();
-        const HistoryReportConfig& config = parser->getConfig();
-
-        if (!timeAxis.isEmpty()) {
-            int totalRows = timeAxis.size() + 1;
-            int totalCols = config.columns.size() + 1;
-
-            // 保留用户自定义列
-            int oldMaxCol = m_dataModel->columnCount();
-            int dataColumnCount = m_dataModel->getDataColumnCount();
-            int userDefinedCols = oldMaxCol - dataColumnCount - 1;
-            if (userDefinedCols > 0) {
-                totalCols += userDefinedCols;
-            }
-
-            m_dataModel->setDataColumnCount(config.columns.size());
+        // 模型已在结果发布时同步快照
+        std::shared_ptr<const UnifiedQueryResult> result = m_dataModel->getUnifiedResult();
+        if (!result) return;
 
-            // 更新尺寸
-			m_dataModel->resetModelSize(totalRows, totalCols);
-        }
+        // Model 尺寸已在查询过程中随部分结果增长（保留用户自定义列），这里不再重置视图
+        const TimeAxis& timeAxis = result->timeAxis;
+        const HistoryReportConfig& config = parser->getConfig();
 
         // ===== 计算公式 =====
         m_dataModel->recalculateAllFormulas();
@@ -865,14 +854,23 @@ void MainWindow::onUnifiedQueryCompleted(bool success, QString message)
         // ===== 在查询成功后保存快照 =====
         m_dataModel->saveRefreshSnapshot();
 
+        // 有效数据点数（对齐阶段按列统计）
+        qint64 validPoints = 0;
+        for (const auto& col : result->columns) {
+            validPoints += result->columnStats.value(col.rtuKey).validCount;
+        }
+
         // ===== 显示详细成功消息 =====
         QMessageBox msgBox(QMessageBox::Information, "查询成功",
             QString("数据查询完成！\n\n"
                 "时间点：%1 个\n"
-                "数据列：%2 个\n\n"
+                "数据列：%2 个\n"
+                "有效数据：%3/%4 个\n\n"
                 "提示：时间列和数据列为只读，您可以在右侧添加自定义列和公式。")
             .arg(timeAxis.size())
-            .arg(config.columns.size()),
+            .arg(config.columns.size())
+            .arg(validPoints)
+            .arg((qint64)timeAxis.size() * config.columns.size()),
             QMessageBox::NoButton, this);
         msgBox.setStandardButtons(QMessageBox::Ok);
         msgBox.setButtonText(QMessageBox::Ok, "确定");
@@ -886,6 +884,52 @@ void MainWindow::onUnifiedQueryCompleted(bool success, QString message)
     }
 }
 
+void MainWindow::onViewportScrolled()
+{
+    int firstRow = m_tableView->rowAt(0);
+    if (firstRow < 0) return;
+
+    int lastRow = m_tableView->rowAt(m_tableView->viewport()->height() - 1);
+    if (lastRow < 0) {
+        lastRow = m_dataModel->rowCount() - 1;
+    }
+
+    // 在视图请求数据之前格式化好可视区域及其后两屏
+    m_dataModel->prefetchDisplayRows(firstRow, lastRow);
+}
+
+void MainWindow::onTemplateRefreshCanceled()
+{
+    m_dataModel->cancelTemplateRefresh();
+
+    if (m_templateRefreshProgress) {
+        m_templateRefreshProgress->setLabelText("正在取消刷新...");
+        m_templateRefreshProgress->setCancelButton(nullptr);
+    }
+}
+
+void MainWindow::onTemplateRefreshCompleted(bool success, bool canceled)
+{
+    m_toolBar->setEnabled(true);
+
+    // 关闭进度框
+    if (m_templateRefreshProgress) {
+        m_templateRefreshProgress->close();
+        m_templateRefreshProgress->deleteLater();
+        m_templateRefreshProgress = nullptr;
+    }
+
+    qDebug() << "模板刷新结束: success=" << success << ", canceled=" << canceled;
+
+    if (canceled) {
+        QMessageBox msgBox(QMessageBox::Warning, "已取消", "数据刷新操作已被用户取消。", QMessageBox::NoButton, this);
+        msgBox.setStandardButtons(QMessageBox::Ok);
+        msgBox.setButtonText(QMessageBox::Ok, "确定");
+        msgBox.exec();
+        m_dataModel->restoreToTemplate();
+    }
+}
+
 void MainWindow::onRefreshData()
 {
     if (m_dataModel->getAllCells().isEmpty()) {
@@ -947,6 +991,9 @@ void MainWindow::onRefreshData()
             qDebug() << "恢复上次时间配置";
             m_timeSettingsDialog->setStartTime(m_lastTimeSettings.config.startTime);
             m_timeSettingsDialog->setReportType(m_lastTimeSettings.reportType);
+            m_timeSettingsDialog->setAlignPolicy(m_lastTimeSettings.config.alignPolicy);
+            m_timeSettingsDialog->setShardSeconds(m_lastTimeSettings.config.shardSeconds);
+            m_timeSettingsDialog->setShardConcurrency(m_lastTimeSettings.config.shardConcurrency);
             // 注意：setReportType 内部会自动计算 endTime，所以不需要手动设置 endTime
         }
         else {
@@ -967,6 +1014,9 @@ void MainWindow::onRefreshData()
         config.startTime = m_timeSettingsDialog->getStartTime();
         config.endTime = m_timeSettingsDialog->getEndTime();
         config.intervalSeconds = m_timeSettingsDialog->getIntervalSeconds();
+        config.alignPolicy = m_timeSettingsDialog->getAlignPolicy();
+        config.shardSeconds = m_timeSettingsDialog->getShardSeconds();
+        config.shardConcurrency = m_timeSettingsDialog->getShardConcurrency();
 
         qDebug() << QString("时间配置：%1 ~ %2, 间隔%3秒")
             .arg(config.startTime.toString())
@@ -1065,47 +1115,43 @@ void MainWindow::onRefreshData()
             return;
         }
 
-        // 创建进度对话框
-        QProgressDialog progress("正在准备数据...", "取消", 0, 0, this);
-        progress.setWindowModality(Qt::WindowModal);
-        progress.setMinimumDuration(500);
-
-        bool needsPrefetch = parser->getPendingQueryCount() > 0 &&
-            !parser->isCacheValid();
-
-        if (needsPrefetch) {
-            progress.setLabelText("正在预查询数据...");
-            progress.setRange(0, 0);
-
-            connect(parser, &BaseReportParser::taskProgress,
-                &progress, [&progress](int current, int total) {
-                    if (progress.maximum() != total) {
-                        progress.setRange(0, total);
-                    }
-                    progress.setValue(current);
-                });
-        }
-        else {
-            progress.setLabelText("正在填充数据...");
-            int queryCount = parser->getPendingQueryCount();
-            if (queryCount > 0) {
-                progress.setRange(0, queryCount);
-                connect(parser, &BaseReportParser::queryProgress,
-                    &progress, &QProgressDialog::setValue);
-            }
-        }
+        // ===== 创建进度框（窗口模态：刷新期间禁止编辑，但界面保持响应） =====
+        m_templateRefreshProgress = new QProgressDialog(
+            "正在准备数据...", "取消", 0, 0, this);
+        m_templateRefreshProgress->setWindowModality(Qt::WindowModal);
+        m_templateRefreshProgress->setMinimumDuration(500);
+        m_templateRefreshProgress->setAutoReset(false);
+        m_templateRefreshProgress->setAutoClose(false);
+
+        disconnect(m_dataModel, &ReportDataModel::templateRefreshStageChanged, nullptr, nullptr);
+        disconnect(m_dataModel, &ReportDataModel::templateRefreshProgress, nullptr, nullptr);
+        disconnect(m_dataModel, &ReportDataModel::templateRefreshFinished, nullptr, nullptr);
+
+        connect(m_dataModel, &ReportDataModel::templateRefreshStageChanged,
+            m_templateRefreshProgress, &QProgressDialog::setLabelText);
+
+        connect(m_dataModel, &ReportDataModel::templateRefreshProgress,
+            m_templateRefreshProgress, [this](int current, int total) {
+                if (!m_templateRefreshProgress) {
+                    return;  // 已结束，排队中的进度事件直接丢弃
+                }
+                if (m_templateRefreshProgress->maximum() != total) {
+                    m_templateRefreshProgress->setRange(0, total);
+                }
+                m_templateRefreshProgress->setValue(current);
+            }, Qt::QueuedConnection);
 
-        bool completed = m_dataModel->refreshReportData(&progress);
+        connect(m_dataModel, &ReportDataModel::templateRefreshFinished,
+            this, &MainWindow::onTemplateRefreshCompleted,
+            Qt::QueuedConnection);
 
-        disconnect(parser, nullptr, &progress, nullptr);
+        connect(m_templateRefreshProgress, &QProgressDialog::canceled,
+            this, &MainWindow::onTemplateRefreshCanceled);
 
-        if (!completed && progress.wasCanceled()) {
-            QMessageBox msgBox(QMessageBox::Warning, "已取消", "数据刷新操作已被用户取消。", QMessageBox::NoButton, this);
-            msgBox.setStandardButtons(QMessageBox::Ok);
-            msgBox.setButtonText(QMessageBox::Ok, "确定");
-            msgBox.exec();
-            m_dataModel->restoreToTemplate();
-        }
+        // ===== 启动刷新流水线，立即返回 =====
+        m_toolBar->setEnabled(false);
+        m_dataModel->startTemplateRefresh();
+        return;
     }
     else {
         m_dataModel->refreshReportData(nullptr);
@@ -63,6 +63,11 @@ private slots:
     void onUnifiedQueryCompleted(bool success, QString message);
     void onUnifiedQueryCanceled();
 
+    void onTemplateRefreshCompleted(bool success, bool canceled);
+    void onTemplateRefreshCanceled();
+
+    void onViewportScrolled();  // 滚动时预格式化可视区域附近的行
+
 private:
     // UI组件
     QWidget* m_centralWidget;
@@ -115,6 +120,7 @@ private:
     } m_lastTimeSettings;
 
     QProgressDialog* m_unifiedQueryProgress = nullptr;
+    QProgressDialog* m_templateRefreshProgress = nullptr;
 
 private:
     void setupUI();
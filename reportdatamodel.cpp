@@ -11,10 +11,12 @@
 #include <QDebug>              // 用于 qDebug
 #include <limits>              // 用于 std::numeric_limits
 #include <cmath>               // 用于 std::isnan, std::isinf
+#include <algorithm>           // 用于 std::sort
 #include <QMessageBox>
 #include <QRegularExpression>
 #include <QPushButton>
 #include <QTimer>
+#include <QtConcurrent>
 
 #include "reportdatamodel.h"
 #include "formulaengine.h"
@@ -23,6 +25,7 @@
 #include "MonthReportParser.h"
 #include "DayReportParser.h"
 #include "UnifiedQueryParser.h"
+#include "RtuDictionary.h"
 
 // QXlsx相关（检查是否已包含）
 #include "xlsxdocument.h"      // 用于 QXlsx::Document
@@ -30,6 +33,11 @@
 #include "xlsxworksheet.h"     // 用于 QXlsx::Worksheet
 #include "xlsxformat.h"        // 用于 QXlsx::Format
 
+// 同一层公式数达到该值时并行求值，较少时串行（避免线程调度开销）
+static const int kParallelFormulaThreshold = 256;
+
+// 一列被区域函数引用的单元格总数达到该值时才为其建立聚合索引
+static const int kAggregateIndexMinCells = 64;
 
 ReportDataModel::ReportDataModel(QObject* parent)
     : QAbstractTableModel(parent)
@@ -41,11 +49,19 @@ ReportDataModel::ReportDataModel(QObject* parent)
     , m_editMode(true)
     , m_currentMode(TEMPLATE_MODE)      // 默认模板模式
     , m_templateType(TemplateType::DAY_REPORT)        // 默认日报
+    , m_refreshCancelRequested(0)
+    , m_fillWatcher(new QFutureWatcher<QVector<FillResult>>(this))
 {
+    connect(m_fillWatcher, &QFutureWatcher<QVector<FillResult>>::finished,
+        this, &ReportDataModel::applyFillResults);
 }
 
 ReportDataModel::~ReportDataModel()
 {
+    // 填充线程读取解析器缓存，必须在释放解析器前结束
+    m_refreshCancelRequested.storeRelease(1);
+    m_fillWatcher->waitForFinished();
+
     clearAllCells();
     delete m_parser;  // 新增：释放解析器
     m_parser = nullptr;
@@ -96,10 +112,6 @@ bool ReportDataModel::loadReportTemplate(const QString& fileName)
         connect(m_parser, &BaseReportParser::asyncTaskCompleted,
             this, [this](bool success, const QString& message) {
                 qDebug() << "日报预查询完成: " << success << message;
-                // **预查询完成后恢复编辑模式**
-                if (m_parser) {
-                    m_parser->setEditState(BaseReportParser::CONFIG_EDIT);
-                }
                 setEditMode(true);  // 恢复可编辑
             }, Qt::QueuedConnection);
 
@@ -119,10 +131,6 @@ bool ReportDataModel::loadReportTemplate(const QString& fileName)
     connect(m_parser, &BaseReportParser::asyncTaskCompleted,
         this, [this](bool success, const QString& message) {
             qDebug() << "月报预查询完成: " << success << message;
-            // **预查询完成后恢复编辑模式**
-            if (m_parser) {
-                m_parser->setEditState(BaseReportParser::CONFIG_EDIT);
-            }
             setEditMode(true);  // 恢复可编辑
         }, Qt::QueuedConnection);
 
@@ -155,103 +163,27 @@ bool ReportDataModel::loadReportTemplate(const QString& fileName)
     return true;
 }
 
-// ===== 检查公式的依赖单元格是否已计算 =====
-bool ReportDataModel::checkFormulaDependenciesReady(int row, int col)
+void ReportDataModel::updateFormulaGraph(const QPoint& pos, const CellData* cell)
 {
-    QSet<QPoint> visited;
-    if (detectCircularDependency(row, col, visited)) {
-        qWarning() << QString("检测到循环依赖: 单元格(%1, %2)").arg(row).arg(col);
-        return false;
-    }
-
-    const CellData* cell = getCell(row, col);
     if (!cell || !cell->hasFormula) {
-        return true;
-    }
-
-    QString formula = cell->formula;
-    QRegularExpression cellRefRegex(R"([A-Z]+\d+)");
-    QRegularExpressionMatchIterator it = cellRefRegex.globalMatch(formula);
-
-    while (it.hasNext()) {
-        QRegularExpressionMatch match = it.next();
-        QString cellRef = match.captured(0);
-        QPoint refPos = parseCellReference(cellRef);
-
-        if (refPos.x() == -1 || refPos.y() == -1) {
-            continue;
-        }
-
-        const CellData* refCell = getCell(refPos.x(), refPos.y());
-        if (refCell && refCell->hasFormula && !refCell->formulaCalculated) {
-            return false;
-        }
+        m_formulaGraph.removeFormula(pos);
+        return;
     }
 
-    return true;
+    // 编译结果按单元格缓存，之后计算时直接复用
+    m_formulaGraph.setFormula(pos, m_formulaEngine->compiled(cell->formula, pos.x(), pos.y()));
 }
 
-bool ReportDataModel::detectCircularDependency(int row, int col, QSet<QPoint>& visitedCells)
+void ReportDataModel::rebuildFormulaGraph()
 {
-    QPoint current(row, col);
-
-    if (visitedCells.contains(current)) {
-        return true;  // 检测到循环
-    }
-
-    const CellData* cell = getCell(row, col);
-    if (!cell || !cell->hasFormula) {
-        return false;
-    }
-
-    visitedCells.insert(current);
-
-    QString formula = cell->formula;
-    QRegularExpression cellRefRegex(R"([A-Z]+\d+)");
-    QRegularExpressionMatchIterator it = cellRefRegex.globalMatch(formula);
-
-    while (it.hasNext()) {
-        QRegularExpressionMatch match = it.next();
-        QString cellRef = match.captured(0);
-        QPoint refPos = parseCellReference(cellRef);
-
-        if (refPos.x() == -1 || refPos.y() == -1) {
-            continue;
-        }
-
-        if (detectCircularDependency(refPos.x(), refPos.y(), visitedCells)) {
-            return true;
+    m_formulaGraph.clear();
+    for (auto it = m_cells.constBegin(); it != m_cells.constEnd(); ++it) {
+        if (it.value() && it.value()->hasFormula) {
+            updateFormulaGraph(it.key(), it.value());
         }
     }
-
-    visitedCells.remove(current);
-    return false;
-}
-
-// ===== 解析单元格引用（如 "I5" -> QPoint(4, 8)） =====
-QPoint ReportDataModel::parseCellReference(const QString& cellRef) const
-{
-    QRegularExpression regex(R"(([A-Z]+)(\d+))");
-    QRegularExpressionMatch match = regex.match(cellRef);
-
-    if (!match.hasMatch()) {
-        return QPoint(-1, -1);
-    }
-
-    QString colStr = match.captured(1);
-    int rowNum = match.captured(2).toInt();
-
-    // 转换列名为列索引（A=0, B=1, ..., Z=25, AA=26, ...）
-    int col = 0;
-    for (int i = 0; i < colStr.length(); ++i) {
-        col = col * 26 + (colStr[i].unicode() - 'A' + 1);
-    }
-    col -= 1;  // 转换为0基索引
-
-    return QPoint(rowNum - 1, col);  // 转换为0基索引
 }
 
-
 void ReportDataModel::recalculateAllFormulas()
 {
     qDebug() << "开始增量计算公式...";
@@ -260,6 +192,10 @@ void ReportDataModel::recalculateAllFormulas()
     for (auto it = m_cells.begin(); it != m_cells.end(); ++it) {
         CellData* cell = it.value();
         if (cell && cell->hasFormula && !cell->formulaCalculated) {
+            // 未经 setData/addCellDirect 登记的公式在此补登
+            if (!m_formulaGraph.contains(it.key())) {
+                updateFormulaGraph(it.key(), cell);
+            }
             // 只有当它不在集合中时才插入，减少冗余
             if (!m_dirtyFormulas.contains(it.key())) {
                 m_dirtyFormulas.insert(it.key());
@@ -276,60 +212,32 @@ void ReportDataModel::recalculateAllFormulas()
         return;
     }
 
-    qDebug() << QString("待计算公式总数: %1").arg(m_dirtyFormulas.size());
+    // 从脏公式出发沿依赖图收集受影响的公式，按拓扑层次逐层计算；环只在排序时检测一次
+    QVector<QPoint> cyclic;
+    const QVector<QVector<QPoint>> levels = m_formulaGraph.evaluationLevels(m_dirtyFormulas, cyclic);
 
-    int maxIterations = 5;
-    int iteration = 0;
+    int affectedCount = cyclic.size();
+    for (const QVector<QPoint>& level : levels) {
+        affectedCount += level.size();
+    }
+    qDebug() << QString("待计算公式: 脏 %1 个, 受影响 %2 个, 共 %3 层")
+        .arg(m_dirtyFormulas.size()).arg(affectedCount).arg(levels.size());
 
-    while (iteration < maxIterations && !m_dirtyFormulas.isEmpty()) {
-        int calculatedCount = 0;
-        QSet<QPoint> stillDirty;
+    ensureAggregateIndex(levels);
+    for (const QVector<QPoint>& level : levels) {
+        calculateFormulaLevel(level);
+    }
 
-        for (const QPoint& pos : m_dirtyFormulas) {
+    if (!cyclic.isEmpty()) {
+        qWarning() << QString("检测到 %1 个公式无法计算，存在循环依赖").arg(cyclic.size());
+        for (const QPoint& pos : cyclic) {
             CellData* cell = getCell(pos.x(), pos.y());
-
-            if (!cell || !cell->hasFormula) {
-                continue;
-            }
-
-            if (cell->formulaCalculated) {
-                continue;
-            }
-
-            // 检查依赖是否已就绪
-            if (checkFormulaDependenciesReady(pos.x(), pos.y())) {
-                calculateFormula(pos.x(), pos.y());
-                calculatedCount++;
-            }
-            else {
-                stillDirty.insert(pos);
-            }
-        }
-
-        m_dirtyFormulas = stillDirty;
-
-        qDebug() << QString("第 %1 轮计算: 计算 %2 个, 剩余 %3 个")
-            .arg(iteration + 1).arg(calculatedCount).arg(m_dirtyFormulas.size());
-
-        if (calculatedCount == 0) {
-            if (!m_dirtyFormulas.isEmpty()) {
-                qWarning() << QString("检测到 %1 个公式无法计算，可能存在循环依赖").arg(m_dirtyFormulas.size());
-                for (const QPoint& pos : m_dirtyFormulas) {
-                    CellData* cell = getCell(pos.x(), pos.y());
-                    if (cell) {
-                        cell->displayValue = QVariant("#循环引用!"); // 或者 "#ERROR!"
-                        cell->formulaCalculated = true; // 标记为已处理 (即使是错误)
-                    }
-                }
+            if (cell) {
+                cell->setValue(CellValue::fromError(CellValue::CircularReference));
+                cell->formulaCalculated = true; // 标记为已处理 (即使是错误)
+                updateAggregateCell(pos.x(), pos.y());
             }
-            break;
         }
-
-        iteration++;
-    }
-
-    if (iteration >= maxIterations && !m_dirtyFormulas.isEmpty()) {
-        qWarning() << "公式计算达到最大迭代次数";
     }
 
     m_dirtyFormulas.clear();
@@ -347,7 +255,9 @@ bool ReportDataModel::refreshReportData(QProgressDialog* progress)
 {
     // ===== 新增：根据模式分发 =====
     if (m_currentMode == TEMPLATE_MODE) {
-        return refreshTemplateReport(progress);
+        // 模板模式走异步流水线，进度与结果通过 templateRefresh* 信号上报
+        startTemplateRefresh();
+        return true;
     }
     else if (m_currentMode == UNIFIED_QUERY_MODE) {
         return refreshUnifiedQuery(progress);
@@ -374,7 +284,7 @@ void ReportDataModel::restoreTemplateReport()
         if (!cell->markerText.isEmpty())
         {
             // 将显示值恢复为原始标记文本
-            cell->displayValue = cell->markerText;
+            cell->setDisplayText(cell->markerText);
 
             // 如果是数据标记，重置查询状态
             if (cell->cellType == CellData::DataMarker) { // 也可以用 markerText.startsWith("#d#")
@@ -387,7 +297,7 @@ void ReportDataModel::restoreTemplateReport()
         else if (cell->hasFormula)
         {
             // 将显示值恢复为公式文本
-            cell->displayValue = cell->formula;
+            cell->setDisplayText(cell->formula);
             cell->formulaCalculated = false; // 标记为未计算
             restoredFormulas++;
         }
@@ -396,6 +306,7 @@ void ReportDataModel::restoreTemplateReport()
 
     qDebug() << QString("模型还原：还原了 %1 个标记单元格, %2 个公式单元格。")
         .arg(restoredMarkers).arg(restoredFormulas);
+    invalidateAggregateIndex();
 
     // --- 保留后续的清理和状态设置 ---
     m_lastSnapshot.bindingKeys.clear();
@@ -483,6 +394,7 @@ void ReportDataModel::restoreUnifiedQuery()
     if (m_parser) {
         m_parser->restoreToTemplate();
     }
+    syncUnifiedResult();
 
     // 清除所有用户添加的单元格（包括公式列）
     QList<QPoint> toRemove;
@@ -495,6 +407,7 @@ void ReportDataModel::restoreUnifiedQuery()
     }
 
     for (const QPoint& pos : toRemove) {
+        m_formulaGraph.removeFormula(pos);
         delete m_cells.take(pos);
     }
 
@@ -679,12 +592,70 @@ QVariant ReportDataModel::data(const QModelIndex& index, int role) const
     return QVariant();
 }
 
-bool ReportDataModel::refreshTemplateReport(QProgressDialog* progress)
+// ===== 模板模式异步刷新流水线 =====
+// 扫描 → 查询 → 填充 → 公式 → 格式化，各阶段通过信号/续接串联，不再嵌套事件循环
+
+void ReportDataModel::startTemplateRefresh()
 {
     if (!m_parser) {
         qWarning() << "解析器为空";
-        return false;
+        emit templateRefreshFinished(false, false);
+        return;
+    }
+
+    if (m_refreshStage != REFRESH_IDLE) {
+        qWarning() << "刷新流水线正在运行，忽略重复请求";
+        return;
+    }
+
+    m_refreshCancelRequested.storeRelease(0);
+    m_refreshFillSuccess = false;
+    invalidateAggregateIndex();     // 重新扫描会改写标记单元格
+    runRefreshRescanStage();
+}
+
+void ReportDataModel::cancelTemplateRefresh()
+{
+    if (m_refreshStage == REFRESH_IDLE) {
+        return;
+    }
+
+    qDebug() << "请求取消刷新，当前阶段：" << m_refreshStage;
+    m_refreshCancelRequested.storeRelease(1);
+
+    // 查询阶段的取消交给后台任务，完成信号到达后再收尾
+    if (m_refreshStage == REFRESH_FETCH && m_parser) {
+        m_parser->requestCancel();
+    }
+}
+
+void ReportDataModel::enterRefreshStage(RefreshStage stage, const QString& label)
+{
+    m_refreshStage = stage;
+    qDebug() << "【刷新流水线】进入阶段" << stage << label;
+    emit templateRefreshStageChanged(label);
+}
+
+void ReportDataModel::disconnectRefreshConnections()
+{
+    for (const QMetaObject::Connection& connection : m_refreshConnections) {
+        disconnect(connection);
     }
+    m_refreshConnections.clear();
+}
+
+void ReportDataModel::finishTemplateRefresh(bool success, bool canceled)
+{
+    disconnectRefreshConnections();
+    m_refreshStage = REFRESH_IDLE;
+
+    qDebug() << "【刷新流水线】结束: success=" << success << ", canceled=" << canceled;
+    emit templateRefreshFinished(success, canceled);
+}
+
+void ReportDataModel::runRefreshRescanStage()
+{
+    enterRefreshStage(REFRESH_RESCAN, "正在扫描模板...");
 
     bool dateMarkerChanged = false;
     // 检查是否有 DateMarker 或 (对月报而言) Date1Marker 在脏单元格中
@@ -711,9 +682,6 @@ bool ReportDataModel::refreshTemplateReport(QProgressDialog* progress)
         connect(m_parser, &BaseReportParser::asyncTaskCompleted,
             this, [this](bool success, const QString& message) {
                 qDebug() << "强制重新扫描后的预查询完成: " << success << message;
-                if (m_parser) {
-                    m_parser->setEditState(BaseReportParser::CONFIG_EDIT);
-                }
                 // 注意：这里不再需要 setEditMode(true)，因为刷新完成后会根据 fillSuccess 设置
             }, Qt::QueuedConnection);
 
@@ -724,15 +692,14 @@ bool ReportDataModel::refreshTemplateReport(QProgressDialog* progress)
             // 失败后，恢复编辑模式可能比较安全
             setEditMode(true);
             m_parser->setEditState(BaseReportParser::CONFIG_EDIT);
-            return false; // 扫描失败则无法继续
+            finishTemplateRefresh(false, false);
+            return; // 扫描失败则无法继续
         }
         // 重新扫描成功后，认为所有单元格都干净了（因为 parser 内部会处理）
         clearDirtyMarks(); // 清理脏标记
         // 重置刷新状态，使其如同首次刷新一样
         m_isFirstRefresh = true;
         qDebug() << "强制重新扫描完成，将按照首次刷新逻辑继续...";
-        // 注意：这里不需要手动调用 refreshTemplateReport，因为当前函数会继续执行后续逻辑
-        // 但是需要确保后续逻辑按照首次刷新的路径走
     }
 
     ChangeType changeType = detectChanges();
@@ -742,24 +709,19 @@ bool ReportDataModel::refreshTemplateReport(QProgressDialog* progress)
     qDebug() << QString("变化检测: isFirstRefresh=%1, changeType=%2, 脏单元格=%3, 新增公式=%4")
         .arg(m_isFirstRefresh).arg(changeType).arg(m_dirtyCells.size()).arg(hasNewFormulas);
 
-    bool fillSuccess = false; // 保存填充操作的结果
-    bool querySuccess = true; // 假设查询成功，除非实际失败
-
     // ===== 分支 1：首次刷新（或还原后）且无编辑 =====
     if (m_isFirstRefresh && !hasDirtyCells) {
         qDebug() << "首次刷新/还原后刷新 且 无脏单元格，直接从缓存填充";
-        fillSuccess = fillDataFromCache(progress);
-        if (progress && progress->wasCanceled()) return false;
-        if (!fillSuccess) {
-            qWarning() << "首次刷新/还原后刷新 时从缓存填充数据失败！";
-            // QMessageBox::warning(...); // 错误消息已移到后面统一处理
-        }
+        // 若预查询仍在进行（如刚重新扫描），查询阶段会等待其完成
+        runRefreshFetchStage(false);
+        return;
     }
     // ===== 分支 2：非首次刷新，无变化 =====
     else if (!m_isFirstRefresh && changeType == NO_CHANGE && !hasDirtyCells) {
         qDebug() << "非首次刷新，无变化";
         QMessageBox::information(nullptr, "无需刷新", "数据已是最新，无需刷新。");
-        return true; // 无需后续处理，直接返回成功
+        finishTemplateRefresh(true, false); // 无需后续处理，直接返回成功
+        return;
     }
     // ===== 分支 3：仅公式变化 =====
     else if (!hasDirtyCells && changeType == FORMULA_ONLY) {
@@ -767,167 +729,250 @@ bool ReportDataModel::refreshTemplateReport(QProgressDialog* progress)
         recalculateAllFormulas();
         saveRefreshSnapshot(); // 仅公式变化也需保存快照
         notifyDataChanged();
-        return true; // 公式计算完成，返回成功
+        finishTemplateRefresh(true, false); // 公式计算完成，返回成功
+        return;
     }
+
     // ===== 分支 4：需要处理数据变化（脏单元格或非首次的绑定变化）=====
-    else {
-        qDebug() << "需要处理数据变化（脏单元格 或 非首次的绑定变化）";
-        bool needQuery = false;
-        bool scanNeeded = false;
+    qDebug() << "需要处理数据变化（脏单元格 或 非首次的绑定变化）";
+    bool needQuery = false;
+    bool scanNeeded = false;
+
+    // ===== 【增强】差分信息和缓存清理 =====
+    BaseReportParser::RescanDiffInfo diffInfo;
 
-        // ===== 【增强】差分信息和缓存清理 =====
-        BaseReportParser::RescanDiffInfo diffInfo;
+    if (hasDirtyCells) {
+        qDebug() << QString("检测到 %1 个脏单元格，进行增量扫描").arg(m_dirtyCells.size());
 
-        if (hasDirtyCells) {
-            qDebug() << QString("检测到 %1 个脏单元格，进行增量扫描").arg(m_dirtyCells.size());
+        // 执行增量扫描，获取差分信息
+        diffInfo = m_parser->rescanDirtyCells(m_dirtyCells);
 
-            // 执行增量扫描，获取差分信息
-            diffInfo = m_parser->rescanDirtyCells(m_dirtyCells);
+        // ===== 【关键判断】是否需要全盘扫描 =====
+        if (diffInfo.hasTimeMarkerChange) {
+            qDebug() << "检测到时间标记变化，切换为全盘扫描";
+
+            // 清空缓存并重新全盘扫描
+            m_parser->invalidateCache();
+            m_parser->clearQueryTasks();  // 清空错误任务
+            scanNeeded = true;
+            needQuery = true;
+        }
+        else {
+            // 只是数据标记变化，使用增量方式
 
-            // ===== 【关键判断】是否需要全盘扫描 =====
-            if (diffInfo.hasTimeMarkerChange) {
-                qDebug() << "检测到时间标记变化，切换为全盘扫描";
+            // 清理受影响的缓存项
+            m_parser->cleanupCacheByDiff(diffInfo);
 
-                // 清空缓存并重新全盘扫描
-                m_parser->invalidateCache();
-                m_parser->clearQueryTasks();  // 清空错误任务
-                scanNeeded = true;
+            // 判断是否需要查询
+            if (diffInfo.newMarkerCount > 0 || !diffInfo.modifiedMarkers.isEmpty()) {
+                qDebug() << "有新增或修改的标记，需要查询";
                 needQuery = true;
             }
+            else if (!diffInfo.removedMarkers.isEmpty()) {
+                qDebug() << "只有删除操作，无需查询";
+                needQuery = false;
+            }
             else {
-                // 只是数据标记变化，使用增量方式
-
-                // 清理受影响的缓存项
-                m_parser->cleanupCacheByDiff(diffInfo);
-
-                // 判断是否需要查询
-                if (diffInfo.newMarkerCount > 0 || !diffInfo.modifiedMarkers.isEmpty()) {
-                    qDebug() << "有新增或修改的标记，需要查询";
-                    needQuery = true;
-                }
-                else if (!diffInfo.removedMarkers.isEmpty()) {
-                    qDebug() << "只有删除操作，无需查询";
-                    needQuery = false;
-                }
-                else {
-                    qDebug() << "无实质性变化，无需查询";
-                    needQuery = false;
-                }
+                qDebug() << "无实质性变化，无需查询";
+                needQuery = false;
             }
         }
-        else if (!m_isFirstRefresh && (changeType == BINDING_ONLY || changeType == MIXED_CHANGE)) {
-            qDebug() << "检测到绑定变化(非首次刷新)，需要重新扫描并查询";
-            m_parser->invalidateCache();
-            scanNeeded = true;
-            needQuery = true;
+    }
+    else if (!m_isFirstRefresh && (changeType == BINDING_ONLY || changeType == MIXED_CHANGE)) {
+        qDebug() << "检测到绑定变化(非首次刷新)，需要重新扫描并查询";
+        m_parser->invalidateCache();
+        scanNeeded = true;
+        needQuery = true;
+    }
+
+    // ===== 执行全盘扫描（如果需要）=====
+    if (scanNeeded) {
+        qDebug() << "执行重新全盘扫描...";
+        if (!m_parser->scanAndParse()) {
+            qWarning() << "重新扫描失败";
+            QMessageBox::warning(nullptr, "扫描失败", "重新扫描模板标记失败，请检查模板。");
+            finishTemplateRefresh(false, false);
+            return;
         }
+    }
 
-        // ===== 执行全盘扫描（如果需要）=====
-        if (scanNeeded) {
-            qDebug() << "执行重新全盘扫描...";
-            if (!m_parser->scanAndParse()) {
-                qWarning() << "重新扫描失败";
-                QMessageBox::warning(nullptr, "扫描失败", "重新扫描模板标记失败，请检查模板。");
-                return false;
-            }
+    runRefreshFetchStage(needQuery);
+}
+
+void ReportDataModel::runRefreshFetchStage(bool startQuery)
+{
+    if (m_refreshCancelRequested.loadAcquire()) {
+        finishTemplateRefresh(false, true);
+        return;
+    }
+
+    // 全盘扫描会自行启动预查询；此时只需等待，不必重复启动
+    bool taskRunning = m_parser->isAsyncTaskRunning();
+    if (!taskRunning && (!startQuery || m_parser->getPendingQueryCount() == 0)) {
+        if (startQuery) {
+            qDebug() << "没有待查询任务，跳过查询";
         }
+        runRefreshFillStage();
+        return;
+    }
+
+    enterRefreshStage(REFRESH_FETCH, "正在查询数据库...");
+    emit templateRefreshProgress(0, 0);  // 不确定进度模式，直到后台任务上报
 
-        // ===== 统一改为异步查询 =====
-        if (needQuery) {
-            qDebug() << "启动异步查询任务...";
+    m_refreshConnections.append(connect(m_parser, &BaseReportParser::taskProgress,
+        this, &ReportDataModel::templateRefreshProgress, Qt::QueuedConnection));
+
+    m_refreshConnections.append(connect(m_parser, &BaseReportParser::asyncTaskCompleted,
+        this, [this](bool success, const QString& message) {
+            disconnectRefreshConnections();
 
-            // 检查是否有待查询任务
-            if (m_parser->getPendingQueryCount() == 0) {
-                qDebug() << "没有待查询任务，跳过查询";
+            if (m_refreshCancelRequested.loadAcquire()) {
+                qDebug() << "用户取消了查询";
+                finishTemplateRefresh(false, true);
+                return;
             }
-            else {
-                // 启动异步任务
-                m_parser->startAsyncTask();
 
-                // 等待异步任务完成（带进度条）
-                if (progress) {
-                    progress->setLabelText("正在查询数据库...");
-                    progress->setRange(0, 0);  // 不确定进度模式
-                }
+            qDebug() << "异步查询完成：" << message;
+            if (!success) {
+                qWarning() << "查询失败/部分失败";
+            }
+            runRefreshFillStage();
+        }, Qt::QueuedConnection));
 
-                // 阻塞等待异步任务完成
-                QEventLoop loop;
-                bool taskCompleted = false;
-                QString taskMessage;
-
-                connect(m_parser, &BaseReportParser::asyncTaskCompleted,
-                    &loop, [&](bool success, const QString& message) {
-                        taskCompleted = true;
-                        querySuccess = success;
-                        taskMessage = message;
-                        loop.quit();
-                    });
-
-                // 定期检查取消
-                QTimer cancelCheckTimer;
-                connect(&cancelCheckTimer, &QTimer::timeout, [&]() {
-                    if (progress && progress->wasCanceled()) {
-                        m_parser->requestCancel();
-                        loop.quit();
-                    }
-                    });
-                cancelCheckTimer.start(100);  // 每100ms检查一次
+    if (taskRunning) {
+        qDebug() << "等待进行中的预查询完成...";
+    }
+    else {
+        qDebug() << "启动异步查询任务...";
+        m_parser->startAsyncTask();
+    }
+}
+
+void ReportDataModel::runRefreshFillStage()
+{
+    if (m_refreshCancelRequested.loadAcquire()) {
+        finishTemplateRefresh(false, true);
+        return;
+    }
 
-                loop.exec();  // 阻塞直到完成
-                cancelCheckTimer.stop();
+    enterRefreshStage(REFRESH_FILL, "正在填充数据...");
 
-                // 检查是否取消
-                if (progress && progress->wasCanceled()) {
-                    qDebug() << "用户取消了查询";
-                    return false;
-                }
+    // 任务快照在 GUI 线程取得；工作线程只查缓存并预先生成数值与显示文本，不写单元格
+    const QList<BaseReportParser::QueryTask> tasks = m_parser->getQueryTasks();
+    BaseReportParser* parser = m_parser;
+    emit templateRefreshProgress(0, tasks.size());
 
-                if (taskCompleted) {
-                    qDebug() << "异步查询完成：" << taskMessage;
-                    if (!querySuccess) {
-                        qWarning() << "查询失败/部分失败";
-                    }
+    m_fillWatcher->setFuture(QtConcurrent::run([this, parser, tasks]() {
+        QVector<FillResult> results;
+        results.reserve(tasks.size());
+
+        const int total = tasks.size();
+        for (int i = 0; i < total; ++i) {
+            if ((i & 0xFF) == 0) {
+                if (m_refreshCancelRequested.loadAcquire()) {
+                    break;
                 }
+                emit templateRefreshProgress(i, total);
             }
+
+            const BaseReportParser::QueryTask& task = tasks.at(i);
+            FillResult result;
+            result.cell = task.cell;
+            result.hit = false;
+
+            float value = 0.0f;
+            if (task.timestampMs >= 0 && parser->findInCache(task.rtuKey, task.timestampMs, value)) {
+                result.hit = true;
+                result.value = CellValue::fromNumber(value);
+            }
+            else {
+                result.value = CellValue::notAvailable();
+            }
+            result.text = result.value.toDisplayString();
+            results.append(result);
         }
 
-        // ===== 填充数据 =====
-        qDebug() << "开始从缓存填充数据 (fillDataFromCache)...";
-        fillSuccess = fillDataFromCache(progress);
-        if (progress && progress->wasCanceled()) return false;
+        emit templateRefreshProgress(results.size(), total);
+        return results;
+        }));
+}
+
+void ReportDataModel::applyFillResults()
+{
+    if (m_refreshCancelRequested.loadAcquire()) {
+        qDebug() << "用户取消填充";
+        finishTemplateRefresh(false, true);
+        return;
     }
 
-    // ===== 后续处理（所有需要填充数据的分支都会执行到这里）=====
+    const QVector<FillResult> results = m_fillWatcher->result();
 
-    recalculateAllFormulas();
-    optimizeMemory();
-    clearDirtyMarks();
+    // 整批写入数据，聚合索引在随后的公式计算中按需重建
+    invalidateAggregateIndex();
+
+    int successCount = 0;
+    for (const FillResult& result : results) {
+        result.cell->cellValue = result.value;
+        result.cell->displayValue = result.text;
+        result.cell->queryExecuted = true;
+        result.cell->querySuccess = result.hit;
+        if (result.hit) {
+            successCount++;
+        }
+    }
+
+    qDebug() << QString("缓存填充完成: 成功 %1, 失败 %2, 总计 %3")
+        .arg(successCount).arg(results.size() - successCount).arg(results.size());
+
+    m_refreshFillSuccess = successCount > 0;
+    runRefreshRecalcStage();
+}
+
+void ReportDataModel::runRefreshRecalcStage()
+{
+    if (m_refreshCancelRequested.loadAcquire()) {
+        finishTemplateRefresh(false, true);
+        return;
+    }
+
+    enterRefreshStage(REFRESH_RECALC, "正在计算公式...");
+    emit templateRefreshProgress(0, 0);
+
+    // 公式计算读写视图正在显示的单元格，留在 GUI 线程；先让出事件循环以刷新进度框
+    QTimer::singleShot(0, this, [this]() {
+        recalculateAllFormulas();
+        optimizeMemory();
+        clearDirtyMarks();
+        runRefreshFormatStage();
+    });
+}
+
+void ReportDataModel::runRefreshFormatStage()
+{
+    enterRefreshStage(REFRESH_FORMAT, "正在格式化报表...");
 
-    // ===== 移动格式化循环到这里！=====
     // 只有在数据填充步骤执行过且成功后才进行格式化
-    if (fillSuccess && m_parser) {
-        qDebug() << "刷新成功，格式化 Date/Time 标记用于显示..."; // <-- 日志点 A
+    if (m_refreshFillSuccess && m_parser) {
+        qDebug() << "刷新成功，格式化 Date/Time 标记用于显示...";
         int formattedCount = 0;
         for (auto it = m_cells.begin(); it != m_cells.end(); ++it) {
             CellData* cell = it.value();
             if (cell && (cell->cellType == CellData::DateMarker || cell->cellType == CellData::TimeMarker)) {
-                // <-- 日志点 B (确认循环进入)
-                // qDebug() << "Formatting cell (" << it.key().x() << "," << it.key().y() << ")";
                 QVariant formattedValue = m_parser->formatDisplayValueForMarker(cell);
-                // <-- 日志点 C (确认返回值)
-                // qDebug() << "  Formatted value:" << formattedValue;
                 if (cell->displayValue != formattedValue) {
-                    cell->displayValue = formattedValue;
+                    cell->setDisplayText(formattedValue);
                     formattedCount++;
                 }
             }
         }
-        qDebug() << "格式化了" << formattedCount << "个 Date/Time 标记的显示值。"; // <-- 日志点 D
+        qDebug() << "格式化了" << formattedCount << "个 Date/Time 标记的显示值。";
+        if (formattedCount > 0) {
+            invalidateAggregateIndex();
+        }
     }
-    // ===================================
 
     // ===== 保存快照并进入运行模式 =====
-    if (fillSuccess) {
+    if (m_refreshFillSuccess) {
         saveRefreshSnapshot(); // 保存当前状态（包括格式化后的displayValue）
         setEditMode(false); // 进入运行模式
         qDebug() << "刷新成功完成，进入运行模式";
@@ -938,7 +983,7 @@ bool ReportDataModel::refreshTemplateReport(QProgressDialog* progress)
     }
 
     notifyDataChanged(); // 通知UI更新最终状态
-    return fillSuccess;
+    finishTemplateRefresh(m_refreshFillSuccess, false);
 }
 
 void ReportDataModel::markRowDataMarkersDirty(int row)
@@ -986,7 +1031,7 @@ bool ReportDataModel::setData(const QModelIndex& index, const QVariant& value, i
     if (text.startsWith("#=#")) {
         cell->hasFormula = true;
         cell->formula = text;
-        cell->displayValue = text;
+        cell->setDisplayText(text);
         cell->markerText.clear();
         cell->cellType = CellData::NormalCell;
         cell->formulaCalculated = false;
@@ -1000,7 +1045,8 @@ bool ReportDataModel::setData(const QModelIndex& index, const QVariant& value, i
         cell->cellType = CellData::DataMarker;
         cell->markerText = text;
         cell->rtuId = rtuId;
-        cell->displayValue = text;
+        cell->rtuKey = RtuDictionary::instance().intern(rtuId);
+        cell->setDisplayText(text);
         cell->queryExecuted = false;
         cell->querySuccess = false;
 
@@ -1029,7 +1075,7 @@ bool ReportDataModel::setData(const QModelIndex& index, const QVariant& value, i
     else if (text.startsWith("#t#", Qt::CaseInsensitive)) {
         cell->cellType = CellData::TimeMarker;
         cell->markerText = text;
-        cell->displayValue = text;
+        cell->setDisplayText(text);
 
         // **关键修改**：时间标记变化也要标记脏
         bool needMarkDirty = false;
@@ -1054,7 +1100,7 @@ bool ReportDataModel::setData(const QModelIndex& index, const QVariant& value, i
     else if (text.startsWith("#Date", Qt::CaseInsensitive)) {
         cell->cellType = CellData::DateMarker;
         cell->markerText = text;
-        cell->displayValue = text;
+        cell->setDisplayText(text);
 
         if (oldType != CellData::DateMarker || oldMarkerText != text) {
             markCellDirty(row, col);
@@ -1076,11 +1122,14 @@ bool ReportDataModel::setData(const QModelIndex& index, const QVariant& value, i
 
         cell->cellType = CellData::NormalCell;
         cell->markerText.clear();
-        cell->displayValue = value;
+        cell->setDisplayText(value);
         cell->rtuId.clear();
+        cell->rtuKey = -1;
     }
 
-    // ===== 标记依赖公式为脏 =====
+    // ===== 更新依赖图与聚合索引，并标记依赖公式为脏 =====
+    updateFormulaGraph(QPoint(row, col), cell);
+    updateAggregateCell(row, col);
     if (!cell->hasFormula) {
         markDependentFormulasDirty(row, col);
     }
@@ -1095,12 +1144,6 @@ Qt::ItemFlags ReportDataModel::getTemplateModeFlags(const QModelIndex& index) co
 {
     if (!index.isValid()) return Qt::NoItemFlags;
 
-    // ===== 检查预查询状态 =====
-    if (m_parser && m_parser->getEditState() == BaseReportParser::PREFETCHING) {
-        // 预查询中：只读
-        return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
-    }
-
     // 运行模式下只读
     if (!m_editMode) {
         return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
@@ -1213,9 +1256,11 @@ bool ReportDataModel::insertRows(int row, int count, const QModelIndex& parent)
     Q_UNUSED(parent)
         if (count <= 0) return false;
 
+    invalidateAggregateIndex();     // 单元格整体移位
     beginInsertRows(QModelIndex(), row, row + count - 1);
 
     QHash<QPoint, CellData*> newCells;
+    QSet<QPoint> newDirty;     // 待重算公式随单元格移位
     for (auto it = m_cells.begin(); it != m_cells.end(); ++it) {
         QPoint oldPos = it.key();
         CellData* cell = it.value();
@@ -1224,6 +1269,7 @@ bool ReportDataModel::insertRows(int row, int count, const QModelIndex& parent)
             // 将此行及以下的单元格向下移动
             QPoint newPos(oldPos.x() + count, oldPos.y());
             newCells[newPos] = cell;
+            if (m_dirtyFormulas.contains(oldPos)) newDirty.insert(newPos);
 
             // 更新合并单元格信息
             if (cell->mergedRange.isValid()) {
@@ -1235,6 +1281,7 @@ bool ReportDataModel::insertRows(int row, int count, const QModelIndex& parent)
         }
         else {
             newCells[oldPos] = cell;
+            if (m_dirtyFormulas.contains(oldPos)) newDirty.insert(oldPos);
 
             // 更新跨越插入行的合并单元格信息
             if (cell->mergedRange.isValid() &&
@@ -1244,6 +1291,8 @@ bool ReportDataModel::insertRows(int row, int count, const QModelIndex& parent)
         }
     }
     m_cells = newCells;
+    m_dirtyFormulas = newDirty;
+    rebuildFormulaGraph();      // 依赖图按坐标登记，移位后重建
     m_maxRow += count;
 
     endInsertRows();
@@ -1256,9 +1305,11 @@ bool ReportDataModel::removeRows(int row, int count, const QModelIndex& parent)
         if (count <= 0 || row < 0 || row + count > m_maxRow)
             return false;
 
+    invalidateAggregateIndex();     // 单元格整体移位
     beginRemoveRows(QModelIndex(), row, row + count - 1);
 
     QHash<QPoint, CellData*> newCells;
+    QSet<QPoint> newDirty;     // 待重算公式随单元格移位
     for (auto it = m_cells.begin(); it != m_cells.end(); ++it) {
         QPoint oldPos = it.key();
         CellData* cell = it.value();
@@ -1271,6 +1322,7 @@ bool ReportDataModel::removeRows(int row, int count, const QModelIndex& parent)
             // 将被移除范围下方的单元格向上移动
             QPoint newPos(oldPos.x() - count, oldPos.y());
             newCells[newPos] = cell;
+            if (m_dirtyFormulas.contains(oldPos)) newDirty.insert(newPos);
 
             // 更新合并单元格信息
             if (cell->mergedRange.isValid()) {
@@ -1282,6 +1334,7 @@ bool ReportDataModel::removeRows(int row, int count, const QModelIndex& parent)
         }
         else {
             newCells[oldPos] = cell;
+            if (m_dirtyFormulas.contains(oldPos)) newDirty.insert(oldPos);
 
             // 更新跨越删除行的合并单元格信息
             if (cell->mergedRange.isValid()) {
@@ -1301,6 +1354,8 @@ bool ReportDataModel::removeRows(int row, int count, const QModelIndex& parent)
         }
     }
     m_cells = newCells;
+    m_dirtyFormulas = newDirty;
+    rebuildFormulaGraph();      // 依赖图按坐标登记，移位后重建
     m_maxRow -= count;
 
     endRemoveRows();
@@ -1312,9 +1367,11 @@ bool ReportDataModel::insertColumns(int column, int count, const QModelIndex& pa
     Q_UNUSED(parent)
         if (count <= 0) return false;
 
+    invalidateAggregateIndex();     // 单元格整体移位
     beginInsertColumns(QModelIndex(), column, column + count - 1);
 
     QHash<QPoint, CellData*> newCells;
+    QSet<QPoint> newDirty;     // 待重算公式随单元格移位
     for (auto it = m_cells.begin(); it != m_cells.end(); ++it) {
         QPoint oldPos = it.key();
         CellData* cell = it.value();
@@ -1322,6 +1379,7 @@ bool ReportDataModel::insertColumns(int column, int count, const QModelIndex& pa
         if (oldPos.y() >= column) {
             QPoint newPos(oldPos.x(), oldPos.y() + count);
             newCells[newPos] = cell;
+            if (m_dirtyFormulas.contains(oldPos)) newDirty.insert(newPos);
 
             // 更新合并单元格信息
             if (cell->mergedRange.isValid()) {
@@ -1333,6 +1391,7 @@ bool ReportDataModel::insertColumns(int column, int count, const QModelIndex& pa
         }
         else {
             newCells[oldPos] = cell;
+            if (m_dirtyFormulas.contains(oldPos)) newDirty.insert(oldPos);
 
             // 更新跨越插入列的合并单元格信息
             if (cell->mergedRange.isValid() &&
@@ -1342,6 +1401,8 @@ bool ReportDataModel::insertColumns(int column, int count, const QModelIndex& pa
         }
     }
     m_cells = newCells;
+    m_dirtyFormulas = newDirty;
+    rebuildFormulaGraph();      // 依赖图按坐标登记，移位后重建
     m_maxCol += count;
 
     endInsertColumns();
@@ -1354,9 +1415,11 @@ bool ReportDataModel::removeColumns(int column, int count, const QModelIndex& pa
         if (count <= 0 || column < 0 || column + count > m_maxCol)
             return false;
 
+    invalidateAggregateIndex();     // 单元格整体移位
     beginRemoveColumns(QModelIndex(), column, column + count - 1);
 
     QHash<QPoint, CellData*> newCells;
+    QSet<QPoint> newDirty;     // 待重算公式随单元格移位
     for (auto it = m_cells.begin(); it != m_cells.end(); ++it) {
         QPoint oldPos = it.key();
         CellData* cell = it.value();
@@ -1367,6 +1430,7 @@ bool ReportDataModel::removeColumns(int column, int count, const QModelIndex& pa
         else if (oldPos.y() >= column + count) {
             QPoint newPos(oldPos.x(), oldPos.y() - count);
             newCells[newPos] = cell;
+            if (m_dirtyFormulas.contains(oldPos)) newDirty.insert(newPos);
 
             // 更新合并单元格信息
             if (cell->mergedRange.isValid()) {
@@ -1378,6 +1442,7 @@ bool ReportDataModel::removeColumns(int column, int count, const QModelIndex& pa
         }
         else {
             newCells[oldPos] = cell;
+            if (m_dirtyFormulas.contains(oldPos)) newDirty.insert(oldPos);
 
             // 更新跨越删除列的合并单元格信息
             if (cell->mergedRange.isValid()) {
@@ -1397,6 +1462,8 @@ bool ReportDataModel::removeColumns(int column, int count, const QModelIndex& pa
         }
     }
     m_cells = newCells;
+    m_dirtyFormulas = newDirty;
+    rebuildFormulaGraph();      // 依赖图按坐标登记，移位后重建
     m_maxCol -= count;
 
     endRemoveColumns();
@@ -1446,6 +1513,11 @@ void ReportDataModel::clearAllCells()
 
     delete m_parser;
     m_parser = nullptr;
+    m_unifiedResult.reset();
+    m_displayCache.reset(nullptr);
+    m_formulaEngine->clearCache();
+    m_formulaGraph.clear();
+    m_aggregateIndex.clear();
 
     m_reportType = NORMAL_EXCEL;
     m_reportName.clear();
@@ -1471,6 +1543,8 @@ void ReportDataModel::addCellDirect(int row, int col, CellData* cell)
         delete m_cells.take(key);
     }
     m_cells.insert(key, cell);
+    updateFormulaGraph(key, cell);
+    updateAggregateCell(row, col);
 }
 
 void ReportDataModel::updateModelSize(int newRowCount, int newColCount)
@@ -1511,10 +1585,155 @@ void ReportDataModel::calculateFormula(int row, int col)
     if (!cell || !cell->hasFormula)
         return;
 
-    // 调用公式引擎计算结果
-    QVariant result = m_formulaEngine->evaluate(cell->formula, this, row, col);
-    cell->displayValue = result;
+    // 调用公式引擎计算结果；非公式文本没有数值结果，保留原文本显示
+    const CellValue result = m_formulaEngine->evaluate(cell->formula, this, row, col);
+    if (result.isNone()) {
+        cell->setDisplayText(cell->formula);
+    }
+    else {
+        cell->setValue(result);
+    }
     cell->formulaCalculated = true;  // 标记已计算
+    updateAggregateCell(row, col);
+}
+
+void ReportDataModel::calculateFormulaLevel(const QVector<QPoint>& level)
+{
+    const int count = level.size();
+
+    // 编译缓存只在 GUI 线程更新：先确保本层公式都已编译，再取指针（之后不再插入，指针保持有效）
+    QVector<CellData*> cells(count, nullptr);
+    for (int i = 0; i < count; ++i) {
+        CellData* cell = getCell(level[i].x(), level[i].y());
+        if (cell && cell->hasFormula) {
+            cells[i] = cell;
+            m_formulaEngine->compiled(cell->formula, level[i].x(), level[i].y());
+        }
+    }
+
+    QVector<const CompiledFormula*> programs(count, nullptr);
+    for (int i = 0; i < count; ++i) {
+        if (cells[i]) {
+            programs[i] = &m_formulaEngine->compiled(cells[i]->formula, level[i].x(), level[i].y());
+        }
+    }
+
+    // 同层公式互不引用，只读取更早层次已写回的结果，并行求值与串行结果一致
+    QVector<CellValue> results(count);
+    QVector<QString> texts(count);
+    auto evaluateOne = [&](int i) {
+        if (programs[i]) {
+            results[i] = m_formulaEngine->run(*programs[i], this);
+            // 非公式文本没有数值结果，保留原文本显示
+            texts[i] = programs[i]->kind == CompiledFormula::Literal
+                ? cells[i]->formula : results[i].toDisplayString();
+        }
+    };
+
+    if (count >= kParallelFormulaThreshold) {
+        QVector<int> indices(count);
+        for (int i = 0; i < count; ++i) {
+            indices[i] = i;
+        }
+        QtConcurrent::blockingMap(indices, [&evaluateOne](int& index) { evaluateOne(index); });
+    }
+    else {
+        for (int i = 0; i < count; ++i) {
+            evaluateOne(i);
+        }
+    }
+
+    // 本层结果批量写回，下一层开始前全部可见
+    for (int i = 0; i < count; ++i) {
+        if (cells[i]) {
+            cells[i]->cellValue = results[i];
+            cells[i]->displayValue = texts[i];
+            cells[i]->formulaCalculated = true;
+            updateAggregateCell(level[i].x(), level[i].y());
+        }
+    }
+}
+
+void ReportDataModel::ensureAggregateIndex(const QVector<QVector<QPoint>>& levels)
+{
+    // 收集本轮待计算的区域函数在每列引用的行区间
+    QHash<int, QVector<QPair<int, int>>> spans;
+    for (const QVector<QPoint>& level : levels) {
+        for (const QPoint& pos : level) {
+            const CellData* cell = getCell(pos.x(), pos.y());
+            if (!cell || !cell->hasFormula) {
+                continue;
+            }
+            const CompiledFormula& formula = m_formulaEngine->compiled(cell->formula, pos.x(), pos.y());
+            if (formula.kind != CompiledFormula::RangeFunction || formula.rangeStart.x() < 0 ||
+                formula.rangeEnd.x() < formula.rangeStart.x() || formula.rangeEnd.y() < formula.rangeStart.y()) {
+                continue;
+            }
+            for (int col = formula.rangeStart.y(); col <= formula.rangeEnd.y(); ++col) {
+                spans[col].append(qMakePair(formula.rangeStart.x(), formula.rangeEnd.x()));
+            }
+        }
+    }
+
+    // 每列按行合并重叠或相邻的区间，只为引用的行建立索引；已被索引覆盖的区间直接复用
+    int builtSegments = 0;
+    int builtRows = 0;
+    for (auto it = spans.begin(); it != spans.end(); ++it) {
+        const int col = it.key();
+        QVector<QPair<int, int>>& ranges = it.value();
+        std::sort(ranges.begin(), ranges.end());
+
+        int index = 0;
+        while (index < ranges.size()) {
+            int firstRow = ranges[index].first;
+            int lastRow = ranges[index].second;
+            qint64 referencedCells = 0;
+            for (; index < ranges.size() && ranges[index].first <= lastRow + 1; ++index) {
+                lastRow = qMax(lastRow, ranges[index].second);
+                referencedCells += ranges[index].second - ranges[index].first + 1;
+            }
+
+            if (referencedCells < kAggregateIndexMinCells || m_aggregateIndex.covers(col, firstRow, lastRow)) {
+                continue;
+            }
+
+            // 与已有索引段重叠时合并为一段重建
+            m_aggregateIndex.expandToSegments(col, firstRow, lastRow);
+            QVector<CellValue> values(lastRow - firstRow + 1);
+            for (int row = firstRow; row <= lastRow; ++row) {
+                values[row - firstRow] = aggregateInputValue(row, col);
+            }
+            m_aggregateIndex.buildSegment(col, firstRow, values);
+            builtSegments++;
+            builtRows += values.size();
+        }
+    }
+
+    if (builtSegments > 0) {
+        qDebug() << QString("区域函数聚合索引: 新建 %1 段, 共 %2 行").arg(builtSegments).arg(builtRows);
+    }
+}
+
+CellValue ReportDataModel::aggregateInputValue(int row, int col) const
+{
+    // 待计算的公式单元格先记为空，计算完成写回结果时再更新索引
+    const CellData* cell = getCell(row, col);
+    if (cell && cell->hasFormula && !cell->formulaCalculated) {
+        return CellValue();
+    }
+    return getCellValueForFormula(row, col);
+}
+
+void ReportDataModel::updateAggregateCell(int row, int col)
+{
+    if (!m_aggregateIndex.isEmpty()) {
+        m_aggregateIndex.update(row, col, aggregateInputValue(row, col));
+    }
+}
+
+void ReportDataModel::invalidateAggregateIndex()
+{
+    m_aggregateIndex.clear();
 }
 
 CellData* ReportDataModel::getCell(int row, int col)
@@ -1522,42 +1741,44 @@ CellData* ReportDataModel::getCell(int row, int col)
     return m_cells.value(QPoint(row, col), nullptr);
 }
 
-QVariant ReportDataModel::getCellValueForFormula(int row, int col) const
+// 按显示值解释用户输入的常量（无数值层结果的单元格）
+static CellValue parseDisplayValue(const QVariant& display)
+{
+    bool ok = false;
+    const double number = display.toDouble(&ok);
+    if (ok) {
+        return CellValue::fromNumber(number);
+    }
+    if (display.toString() == "N/A") {
+        return CellValue::notAvailable();
+    }
+    return CellValue();
+}
+
+CellValue ReportDataModel::getCellValueForFormula(int row, int col) const
 {
     // ===== 统一查询模式：优先从虚拟数据读取 =====
     if (m_currentMode == UNIFIED_QUERY_MODE) {
-        UnifiedQueryParser* queryParser = dynamic_cast<UnifiedQueryParser*>(m_parser);
-        if (queryParser) {
-            const QVector<QDateTime>& timeAxis = queryParser->getTimeAxis();
-            const HistoryReportConfig& config = queryParser->getConfig();
-            const QHash<QString, QVector<double>>& data = queryParser->getAlignedData();
+        const UnifiedQueryResult* result = m_unifiedResult.get();
 
-            // 如果有查询数据
-            if (!timeAxis.isEmpty()) {
-                // 跳过表头行
-                if (row == 0) {
-                    return QVariant();
-                }
+        // 如果有查询数据
+        if (result && !result->isEmpty()) {
+            // 跳过表头行
+            if (row == 0) {
+                return CellValue();
+            }
 
-                int dataRow = row - 1;
-                if (dataRow >= 0 && dataRow < timeAxis.size()) {
-                    // 时间列（第0列）
-                    if (col == 0) {
-                        return timeAxis[dataRow].toString("yyyy-MM-dd HH:mm:ss");
-                    }
-                    // 数据列（第1列到第N列）
-                    else if (col >= 1 && col <= m_dataColumnCount) {
-                        int configIndex = col - 1;
-                        if (configIndex < config.columns.size()) {
-                            QString rtuId = config.columns[configIndex].rtuId;
-                            if (data.contains(rtuId) && dataRow < data[rtuId].size()) {
-                                double value = data[rtuId][dataRow];
-                                if (std::isnan(value) || std::isinf(value)) {
-                                    return QVariant("N/A");  // N/A 视为空值
-                                }
-                                return value;  // 返回数值，不要转成字符串
-                            }
-                        }
+            int dataRow = row - 1;
+            if (dataRow >= 0 && dataRow < result->readyRows) {
+                // 时间列（第0列）不参与数值计算
+                if (col == 0) {
+                    return CellValue();
+                }
+                // 数据列（第1列到第N列）：直接取对齐结果，NaN/inf 视为 N/A
+                else if (col >= 1 && col <= m_dataColumnCount) {
+                    const QVector<double>* values = result->column(col - 1);
+                    if (values && dataRow < values->size()) {
+                        return CellValue::fromNumber(values->at(dataRow));
                     }
                 }
             }
@@ -1567,22 +1788,34 @@ QVariant ReportDataModel::getCellValueForFormula(int row, int col) const
     // ===== 模板模式或用户自定义列：从 m_cells 读取 =====
     const CellData* cell = getCell(row, col);
     if (!cell) {
-        return QVariant();
-    }
-
-    // 如果单元格有公式且已计算，返回计算结果
-    if (cell->hasFormula && cell->formulaCalculated) {
-        return cell->displayValue;  // 使用 displayValue
+        return CellValue();
     }
 
     // 如果单元格有公式但未计算，返回 0（避免循环依赖）
     if (cell->hasFormula && !cell->formulaCalculated) {
         qWarning() << QString("引用了未计算的公式单元格: (%1, %2)").arg(row).arg(col);
-        return QVariant(0.0);
+        return CellValue::fromNumber(0.0);
     }
 
-    // 普通单元格，返回显示值
-    return cell->displayValue;  // 使用 displayValue
+    // 查询结果与已计算的公式结果直接取数值层（原始精度）
+    if (!cell->cellValue.isNone()) {
+        return cell->cellValue;
+    }
+
+    // 普通单元格，按显示值解释
+    return parseDisplayValue(cell->displayValue);
+}
+
+bool ReportDataModel::aggregateRange(const QPoint& start, const QPoint& end,
+    RangeAggregateIndex::Aggregate& result) const
+{
+    return m_aggregateIndex.query(start, end, result);
+}
+
+bool ReportDataModel::sumRange(const QPoint& start, const QPoint& end,
+    double& sum, int& count) const
+{
+    return m_aggregateIndex.sum(start, end, sum, count);
 }
 
 const CellData* ReportDataModel::getCell(int row, int col) const
@@ -1870,17 +2103,11 @@ void ReportDataModel::markFormulaDirty(int row, int col)
 
 void ReportDataModel::markDependentFormulasDirty(int changedRow, int changedCol)
 {
-    QString changedAddr = cellAddress(changedRow, changedCol);
-
-    // 遍历所有公式单元格
-    for (auto it = m_cells.constBegin(); it != m_cells.constEnd(); ++it) {
-        const CellData* cell = it.value();
-        if (!cell || !cell->hasFormula) continue;
-
-        // 检查公式是否引用了被修改的单元格
-        if (cell->formula.contains(changedAddr, Qt::CaseInsensitive)) {
-            m_dirtyFormulas.insert(it.key());
-        }
+    // 直接引用者（含区域引用）；间接引用者在重算时沿依赖图展开
+    QVector<QPoint> dependents;
+    m_formulaGraph.appendDependents(QPoint(changedRow, changedCol), dependents);
+    for (const QPoint& pos : dependents) {
+        m_dirtyFormulas.insert(pos);
     }
 
     if (!m_dirtyFormulas.isEmpty()) {
@@ -1919,6 +2146,11 @@ bool ReportDataModel::loadUnifiedQueryConfig(const QString& filePath)
             return false;
         }
         qDebug() << QString("统一查询配置加载完成：%1 个数据列").arg(config.columns.size());
+
+        // 结果快照在后台线程发布，回到 GUI 线程后再替换模型持有的指针
+        connect(queryParser, &UnifiedQueryParser::resultPublished,
+            this, &ReportDataModel::syncUnifiedResult, Qt::QueuedConnection);
+        syncUnifiedResult();
     }
 
     qDebug() << "统一查询配置加载完成";
@@ -1938,7 +2170,7 @@ bool ReportDataModel::refreshUnifiedQuery(QProgressDialog* progress)
 
     // ===== 检查时间配置 =====
     if (queryParser->getQueryIntervalSeconds() == 0 &&
-        queryParser->getTimeAxis().isEmpty()) {
+        queryParser->getResult()->isEmpty()) {
         qWarning() << "时间配置无效";
         return false;
     }
@@ -1954,18 +2186,14 @@ QVariant ReportDataModel::getUnifiedQueryCellData(const QModelIndex& index, int
 {
     if (!index.isValid()) return QVariant();
 
-    UnifiedQueryParser* queryParser = dynamic_cast<UnifiedQueryParser*>(m_parser);
-    if (!queryParser) return QVariant();
-
     int row = index.row();
     int col = index.column();
 
-    const QVector<QDateTime>& timeAxis = queryParser->getTimeAxis();
-    const HistoryReportConfig& config = queryParser->getConfig();
-    const QHash<QString, QVector<double>>& data = queryParser->getAlignedData();
+    // 只读快照：绘制时不加锁、不做类型转换
+    const UnifiedQueryResult* result = m_unifiedResult.get();
 
     // ===== 判断当前是配置阶段还是报表阶段 =====
-    if (timeAxis.isEmpty()) {
+    if (!result || result->isEmpty()) {
         // 【配置阶段】显示真实 cells（2列）
         if (role == Qt::DisplayRole || role == Qt::EditRole) {
             const CellData* cell = getCell(row, col);
@@ -1973,7 +2201,8 @@ QVariant ReportDataModel::getUnifiedQueryCellData(const QModelIndex& index, int
         }
 
         if (role == Qt::BackgroundRole) {
-            return QBrush(QColor(250, 250, 250));
+            static const QBrush configBrush(QColor(250, 250, 250));
+            return configBrush;
         }
 
         if (role == Qt::TextAlignmentRole) {
@@ -2032,31 +2261,16 @@ QVariant ReportDataModel::getUnifiedQueryCellData(const QModelIndex& index, int
             // 表头行
             if (row == 0) {
                 if (col == 0) return "时间";
-                if (col - 1 < config.columns.size()) {
-                    return config.columns[col - 1].displayName;
+                if (col - 1 < result->columns.size()) {
+                    return result->columns[col - 1].displayName;
                 }
                 return QVariant();
             }
 
-            // 数据行
-            int dataRow = row - 1;
-            if (dataRow >= 0 && dataRow < timeAxis.size()) {
-                // 时间列
-                if (col == 0) {
-                    return timeAxis[dataRow].toString("yyyy-MM-dd HH:mm:ss");
-                }
-                // 数据列
-                else if (col - 1 < config.columns.size()) {
-                    QString rtuId = config.columns[col - 1].rtuId;
-                    if (data.contains(rtuId) && dataRow < data[rtuId].size()) {
-                        double value = data[rtuId][dataRow];
-                        if (std::isnan(value) || std::isinf(value)) {
-                            return "N/A";
-                        }
-                        return QString::number(value, 'f', 2);
-                    }
-                    return "N/A";
-                }
+            // 数据行：时间列与数据列的显示文本取自可视窗口缓存
+            const QString* text = m_displayCache.text(row - 1, col);
+            if (text) {
+                return *text;
             }
         }
 
@@ -2065,36 +2279,113 @@ QVariant ReportDataModel::getUnifiedQueryCellData(const QModelIndex& index, int
         }
 
         if (role == Qt::BackgroundRole) {
+            // 共享的只读画刷，重绘时不再逐格构造
+            static const QBrush headerBrush(QColor(220, 220, 220));
+            static const QBrush userEvenBrush(QColor(255, 255, 240));
+            static const QBrush userOddBrush(QColor(250, 250, 235));
+            static const QBrush dataEvenBrush(Qt::white);
+            static const QBrush dataOddBrush(QColor(248, 248, 248));
+
             if (row == 0) {
-                return QBrush(QColor(220, 220, 220));  // 表头灰色
+                return headerBrush;  // 表头灰色
             }
 
             // ===== 用户自定义列使用不同背景色 =====
             if (col > m_dataColumnCount) {
-                return (row % 2 == 0) ? QBrush(QColor(255, 255, 240)) : QBrush(QColor(250, 250, 235));
+                return (row % 2 == 0) ? userEvenBrush : userOddBrush;
             }
 
-            return (row % 2 == 0) ? QBrush(Qt::white) : QBrush(QColor(248, 248, 248));
+            return (row % 2 == 0) ? dataEvenBrush : dataOddBrush;
         }
 
         if (role == Qt::FontRole) {
-            QFont font;
-            if (row == 0) font.setBold(true);
-            return font;
+            static const QFont normalFont;
+            static const QFont headerFont = []() {
+                QFont font;
+                font.setBold(true);
+                return font;
+            }();
+            return (row == 0) ? headerFont : normalFont;
         }
     }
 
     return QVariant();
 }
 
+void ReportDataModel::syncUnifiedResult()
+{
+    UnifiedQueryParser* queryParser = dynamic_cast<UnifiedQueryParser*>(m_parser);
+    std::shared_ptr<const UnifiedQueryResult> result = queryParser ? queryParser->getResult() : nullptr;
+    std::shared_ptr<const UnifiedQueryResult> previous = m_unifiedResult;
+
+    // 数据列的数值随快照变化（新定稿的行或新的查询），聚合索引在下次计算时重建
+    invalidateAggregateIndex();
+
+    // ===== 同一次查询的后续快照：只追加新定稿的行，不重置视图（保留滚动位置与选择）=====
+    if (previous && result && result->sharesDataWith(*previous)) {
+        const int newRowCount = result->readyRows + 1;
+        if (newRowCount > m_maxRow) {
+            beginInsertRows(QModelIndex(), m_maxRow, newRowCount - 1);
+            m_unifiedResult = result;
+            m_displayCache.reset(result);
+            m_maxRow = newRowCount;
+            endInsertRows();
+        }
+        else {
+            m_unifiedResult = result;
+            m_displayCache.reset(result);
+        }
+        return;
+    }
+
+    // ===== 新查询的首个快照、查询失败后恢复的快照或空快照 =====
+    const bool hadData = previous && !previous->isEmpty();
+    const bool hasData = result && !result->isEmpty();
+    if (!hadData && !hasData) {
+        m_unifiedResult = result;
+        m_displayCache.reset(result);
+        return;
+    }
+
+    beginResetModel();
+    m_unifiedResult = result;
+    m_displayCache.reset(result);
+    if (hasData) {
+        // 数据列随结果更新，保留用户自定义列；行数随已定稿的行增长
+        int totalCols = result->columns.size() + 1;
+        int userDefinedCols = m_maxCol - m_dataColumnCount - 1;
+        if (userDefinedCols > 0) {
+            totalCols += userDefinedCols;
+        }
+
+        m_dataColumnCount = result->columns.size();
+        updateModelSize(result->readyRows + 1, totalCols);
+    }
+    else {
+        // 恢复为配置视图（2列）
+        m_dataColumnCount = 0;
+        updateModelSize(queryParser ? queryParser->getConfig().columns.size() : 0, 2);
+    }
+    endResetModel();
+}
+
+void ReportDataModel::prefetchDisplayRows(int firstRow, int lastRow)
+{
+    if (m_currentMode != UNIFIED_QUERY_MODE) {
+        return;
+    }
+
+    // 模型第0行为表头，缓存使用数据行号
+    m_displayCache.ensureRows(firstRow - 1, lastRow - 1);
+}
+
 bool ReportDataModel::hasUnifiedQueryData() const
 {
     if (m_currentMode != UNIFIED_QUERY_MODE || !m_parser) {
         return false;
     }
 
-    UnifiedQueryParser* queryParser = dynamic_cast<UnifiedQueryParser*>(m_parser);
-    return queryParser && !queryParser->getTimeAxis().isEmpty();
+    return m_unifiedResult && !m_unifiedResult->isEmpty();
 }
 
 void ReportDataModel::setTimeRangeForQuery(const TimeRangeConfig& config)
@@ -2217,246 +2508,10 @@ ReportDataModel::UnifiedQueryChangeType ReportDataModel::detectUnifiedQueryChang
     }
 }
 
-void ReportDataModel::markAllCellsClean()
-{
-    m_dirtyCells.clear();
-    qDebug() << "所有单元格已标记为干净";
-}
-
-bool ReportDataModel::fillDataFromCache(QProgressDialog* progress)
-{
-    if (!m_parser) {
-        return false;
-    }
-
-    qDebug() << "开始从缓存填充数据...";
-
-    int successCount = 0;
-    int failCount = 0;
-    int totalDataMarkers = 0;
-
-    // 统计数据标记总数
-    for (auto it = m_cells.constBegin(); it != m_cells.constEnd(); ++it) {
-        const CellData* cell = it.value();
-        if (cell && cell->cellType == CellData::DataMarker) {
-            totalDataMarkers++;
-        }
-    }
-
-    if (progress) {
-        progress->setRange(0, totalDataMarkers);
-        progress->setLabelText("正在填充数据...");
-    }
-
-    int processedCount = 0;
-
-    // 遍历所有数据标记单元格
-    for (auto it = m_cells.begin(); it != m_cells.end(); ++it) {
-        CellData* cell = it.value();
-        if (!cell || cell->cellType != CellData::DataMarker) {
-            continue;
-        }
-
-        int row = it.key().x();
-        int col = it.key().y();
-
-        // ===== 【添加】只为新增行打印日志 =====
-        qDebug() << QString("【填充数据】[%1,%2] RTU=%3, cellType=%4")
-            .arg(row)
-            .arg(col)
-            .arg(cell->rtuId)
-            .arg((int)cell->cellType);
-        // ====================================
-
-        // 根据报表类型构造时间戳
-        QDateTime dateTime;
-
-        if (m_reportType == DAY_REPORT) {
-            dateTime = constructDateTimeForDayReport(row, col);
-        }
-        else if (m_reportType == MONTH_REPORT) {
-            dateTime = constructDateTimeForMonthReport(row, col);
-        }
-
-        // ===== 【修改】新增行打印时间戳 =====
-        if (row >= 19 && dateTime.isValid()) {
-            int64_t timestamp = dateTime.toMSecsSinceEpoch();
-            qDebug() << QString("  → 构造时间戳: %1 (%2)")
-                .arg(timestamp)
-                .arg(dateTime.toString("yyyy-MM-dd HH:mm:ss"));
-        }
-        // ===================================
-
-        // 从缓存查找数据
-        if (dateTime.isValid()) {
-            int64_t timestamp = dateTime.toMSecsSinceEpoch();
-            float value = 0.0f;
-
-            if (m_parser->findInCache(cell->rtuId, timestamp, value)) {
-                cell->displayValue = QString::number(value, 'f', 2);  // 更新显示值
-                cell->queryExecuted = true;
-                cell->querySuccess = true;
-                successCount++;
-
-                // ===== 【添加】新增行打印结果 =====
-                if (row >= 19) {
-                    qDebug() << QString("  → 缓存命中: value=%1").arg(value);
-                }
-                // ==================================
-            }
-            else {
-                cell->displayValue = "N/A";  // 更新显示值
-                cell->queryExecuted = true;
-                cell->querySuccess = false;
-                failCount++;
-
-                // ===== 【添加】新增行打印失败 =====
-                if (row >= 19) {
-                    qDebug() << QString("  → 缓存未命中");
-                }
-                // ==================================
-            }
-        }
-        else {
-            cell->value = "N/A";
-            cell->queryExecuted = true;
-            cell->querySuccess = false;
-            failCount++;
-        }
-
-        processedCount++;
-        if (progress) {
-            progress->setValue(processedCount);
-            if (progress->wasCanceled()) {
-                qDebug() << "用户取消填充";
-                return false;
-            }
-        }
-    }
-
-    qDebug() << QString("缓存填充完成: 成功 %1, 失败 %2, 总计 %3")
-        .arg(successCount).arg(failCount).arg(totalDataMarkers);
-
-    return successCount > 0;
-}
-
-// 辅助方法：为日报构造日期时间
-QDateTime ReportDataModel::constructDateTimeForDayReport(int row, int col)
-{
-    DayReportParser* dayParser = dynamic_cast<DayReportParser*>(m_parser);
-    if (!dayParser || dayParser->getBaseDate().isEmpty()) {
-        qWarning() << "Row" << row << ": DayReportParser invalid or baseDate empty.";
-        return QDateTime();
-    }
-
-    // 【修复】在同一行向左查找时间标记 (从当前数据单元格的列开始向左)
-    // 这保证了我们找到的是逻辑上属于这个数据块的那个#t#标记
-    QTime time;
-    bool timeFound = false;
-    for (int c = col; c >= 0; --c) { // <--- 关键修改：从 col 开始，向左 (c--) 搜索
-        const CellData* timeCell = getCell(row, c);
-
-        // ===== 检查 markerText 并从中解析 =====
-        if (timeCell && !timeCell->markerText.isEmpty() && timeCell->markerText.startsWith("#t#", Qt::CaseInsensitive)) {
-            QString timeMarker = timeCell->markerText;
-
-            // 调用 extractTime 从 markerText 解析时间字符串 "HH:mm:ss"
-            // (我们复用 parser 里的解析逻辑，保持一致)
-            QString timeStr = m_parser->extractTime(timeMarker);
-
-            if (!timeStr.isEmpty()) {
-                time = QTime::fromString(timeStr, "HH:mm:ss");
-                if (time.isValid()) {
-                    timeFound = true;
-                }
-                else {
-                    qWarning() << "Row" << row << ": Failed to parse extracted time:" << timeStr << "from marker" << timeMarker;
-                }
-            }
-            else {
-                qWarning() << "Row" << row << ": extractTime failed for marker:" << timeMarker;
-            }
-
-            break; // <--- 关键修改：找到第一个（即最近的）#t#标记后立即停止
-        }
-    }
-
-    if (timeFound) {
-        QString baseDateStr = dayParser->getBaseDate();
-        QDate date = QDate::fromString(baseDateStr, "yyyy-MM-dd");
-        QDateTime result = QDateTime(date, time);
-
-        return result;
-    }
-    else {
-        // 只有在循环结束后仍未找到时间才打印此警告
-        // 【增强调试】加入列信息
-        qWarning() << "Row" << row << " Col" << col << ": Could not find valid TimeMarker cell or parse time.";
-    }
-    return QDateTime();
-}
-
-// 辅助方法：为月报构造日期时间
-QDateTime ReportDataModel::constructDateTimeForMonthReport(int row, int col)
+void ReportDataModel::markCellsClean(const QSet<QPoint>& cells)
 {
-    MonthReportParser* monthParser = dynamic_cast<MonthReportParser*>(m_parser);
-    if (!monthParser || monthParser->getBaseYearMonth().isEmpty() || monthParser->getBaseTime().isEmpty()) {
-        qWarning() << "Row" << row << ": MonthReportParser invalid or base date/time empty.";
-        return QDateTime();
-    }
-
-    // 【修复】在同一行查找日期标记 (#t# 代表日)
-    // 统一为“从当前数据单元格的列开始向左查找”
-    int day = 0;
-    bool dayFound = false;
-    for (int c = col; c >= 0; --c) { // <--- 关键修改：从 col 开始，向左 (c--) 搜索
-        const CellData* dayCell = getCell(row, c);
-
-        // ===== 检查 markerText 并从中解析 =====
-        if (dayCell && !dayCell->markerText.isEmpty() && dayCell->markerText.startsWith("#t#", Qt::CaseInsensitive)) {
-            QString dayMarker = dayCell->markerText;
-
-            // 直接从 markerText 中提取数字部分
-            QString dayStr = dayMarker.mid(3).trimmed();
-            bool ok = false;
-            day = dayStr.toInt(&ok);
-
-            // 增加对 day 范围的检查
-            if (!ok || day < 1 || day > 31) {
-                qWarning() << "Row" << row << ": Failed to parse valid day number from markerText:" << dayMarker;
-                day = 0; // 重置为无效值
-            }
-            else {
-                dayFound = true;
-            }
-
-            break; // <--- 关键修改：找到了标记单元格就跳出内层循环
-        }
-        // ===========================================
-    }
-
-    if (dayFound) {
-        QString yearMonth = monthParser->getBaseYearMonth();
-        QString baseTimeStr = monthParser->getBaseTime(); // 应为 "HH:mm:ss" 格式
-        QString fullDateStr = QString("%1-%2").arg(yearMonth).arg(day, 2, 10, QChar('0'));
-        QDate date = QDate::fromString(fullDateStr, "yyyy-MM-dd");
-        QTime time = QTime::fromString(baseTimeStr, "HH:mm:ss");
-
-        // 增加对 date 和 time 有效性的检查和日志
-        if (date.isValid() && time.isValid()) {
-            return QDateTime(date, time);
-        }
-        else {
-            qWarning() << "Row" << row << ": Failed to construct valid QDateTime. Date valid:" << date.isValid() << "Time valid:" << time.isValid() << "DateStr:" << fullDateStr << "TimeStr:" << baseTimeStr;
-        }
-    }
-    else {
-        // 只有在循环结束后仍未找到日期才打印此警告
-        // 【增强调试】加入列信息
-        qWarning() << "Row" << row << " Col" << col << ": Could not find valid TimeMarker cell or parse day number.";
-    }
-
-    return QDateTime();
+    m_dirtyCells.subtract(cells);
+    qDebug() << "已清除" << cells.size() << "个单元格的脏标记，剩余" << m_dirtyCells.size();
 }
 
 void ReportDataModel::markCellDirty(int row, int col)
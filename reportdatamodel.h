@@ -2,6 +2,9 @@
 #define REPORTDATAMODEL_H
 
 #include "DataBindingConfig.h"
+#include "UnifiedDisplayCache.h"
+#include "FormulaDependencyGraph.h"
+#include "RangeAggregateIndex.h"
 #include <QHash>
 #include <QAbstractTableModel>
 #include <QFontInfo>
@@ -11,6 +14,9 @@
 #include <QSize>
 #include <QVector> 
 #include <QProgressDialog>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <memory>
 
 inline uint qHash(const QPoint& key, uint seed = 0) noexcept
 {
@@ -21,6 +27,7 @@ class BaseReportParser;
 class MonthReportParser;
 class DayReportParser;
 class UnifiedQueryParser;  // 新增前向声明
+struct UnifiedQueryResult;
 class FormulaEngine;
 class QProgressDialog;
 
@@ -69,6 +76,8 @@ public:
 
     // ===== 统一查询模式接口 =====
     bool hasUnifiedQueryData() const;  // 新增：判断是否已查询数据
+    std::shared_ptr<const UnifiedQueryResult> getUnifiedResult() const { return m_unifiedResult; }  // 当前显示的查询结果快照
+    void prefetchDisplayRows(int firstRow, int lastRow);  // 预先格式化可视区域附近的行（模型行号）
     void setTimeRangeForQuery(const TimeRangeConfig& config);  // 新增：设置时间范围
     bool exportConfigFile(const QString& fileName);  // 保留：导出配置
 
@@ -118,8 +127,15 @@ public:
     CellData* getCell(int row, int col);
     CellData* ensureCell(int row, int col);
     void calculateFormula(int row, int col);
+    void calculateFormulaLevel(const QVector<QPoint>& level);  // 计算互不依赖的一层公式（较多时并行）
+    void ensureAggregateIndex(const QVector<QVector<QPoint>>& levels);  // 为本轮区域函数引用的行区间补建聚合索引
     QString cellAddress(int row, int col) const;
-    QVariant getCellValueForFormula(int row, int col) const;
+    CellValue getCellValueForFormula(int row, int col) const;  // 公式读取的类型化数值
+    bool aggregateRange(const QPoint& start, const QPoint& end,
+        RangeAggregateIndex::Aggregate& result) const;        // 区域最值与个数（未建索引时返回 false）
+    bool sumRange(const QPoint& start, const QPoint& end,
+        double& sum, int& count) const;                        // 区域求和，逐格顺序累加（未建索引时返回 false）
+    void invalidateAggregateIndex();                           // 整批写入单元格后使聚合索引失效
 
     // 行高列宽
     void setRowHeight(int row, double height);
@@ -151,17 +167,28 @@ public:
     void setDataColumnCount(int count) { m_dataColumnCount = count; }
 
 	// ===== 脏标记管理 =====
-    void markAllCellsClean();
+    void markCellsClean(const QSet<QPoint>& cells);  // 只清除指定单元格的脏标记
     bool hasDirtyCells() const { return !m_dirtyCells.isEmpty(); }
+    QSet<QPoint> dirtyCells() const { return m_dirtyCells; }
     int getDirtyCellCount() const { return m_dirtyCells.size(); }
     void markCellDirty(int row, int col);
     void markRegionDirty(int startRow, int startCol, int endRow, int endCol);
     void clearDirtyMarks();
 
+    // ===== 模板模式异步刷新（扫描 → 查询 → 填充 → 公式 → 格式化） =====
+    void startTemplateRefresh();       // 立即返回，结束时发射 templateRefreshFinished
+    void cancelTemplateRefresh();
+    bool isTemplateRefreshRunning() const { return m_refreshStage != REFRESH_IDLE; }
+
 signals:
     void cellChanged(int row, int col);
     void editModeChanged(bool editMode);
 
+    // ===== 模板刷新流水线信号 =====
+    void templateRefreshStageChanged(const QString& label);
+    void templateRefreshProgress(int current, int total);  // total 为 0 表示不确定进度
+    void templateRefreshFinished(bool success, bool canceled);
+
 private:
     QHash<QPoint, CellData*> m_cells;
     int m_maxRow;
@@ -189,30 +216,67 @@ private:
     bool m_isFirstRefresh = true;
     bool m_editMode = true;
     QSet<QPoint> m_dirtyFormulas;
+    FormulaDependencyGraph m_formulaGraph;  // 公式引用关系（公式文本变化时增量更新）
+    RangeAggregateIndex m_aggregateIndex;   // 区域函数引用行区间的聚合索引（逐格写入时更新，整批写入时失效）
 
     // ===== 模式管理变量 =====
     ReportMode m_currentMode;
     TemplateType m_templateType;
 
     int m_dataColumnCount = 0;  // 新增：记录统一查询模式下数据列数
+    std::shared_ptr<const UnifiedQueryResult> m_unifiedResult;  // 统一查询结果快照（仅 GUI 线程更新，读取无需加锁）
+    mutable UnifiedDisplayCache m_displayCache;                 // 可视区域显示文本缓存
 
     // 脏标记集合
     QSet<QPoint> m_dirtyCells;  // 脏单元格集合
 
+    // ===== 模板刷新流水线状态 =====
+    enum RefreshStage {
+        REFRESH_IDLE,
+        REFRESH_RESCAN,   // 增量/全盘扫描（GUI 线程）
+        REFRESH_FETCH,    // 等待后台预查询
+        REFRESH_FILL,     // 工作线程查缓存，GUI 线程回写单元格
+        REFRESH_RECALC,   // 公式计算
+        REFRESH_FORMAT    // 标记格式化、保存快照
+    };
+
+    // 填充阶段工作线程的输出：显示文本预先格式化好，GUI 线程只做赋值
+    struct FillResult {
+        CellData* cell;
+        bool hit;
+        CellValue value;    // 原始数值（未命中为 N/A）
+        QString text;       // 预先格式化的显示文本
+    };
+
+    RefreshStage m_refreshStage = REFRESH_IDLE;
+    bool m_refreshFillSuccess = false;
+    QAtomicInt m_refreshCancelRequested;
+    QList<QMetaObject::Connection> m_refreshConnections;  // 当前阶段的临时连接
+    QFutureWatcher<QVector<FillResult>>* m_fillWatcher;
+
 private:
-    bool fillDataFromCache(QProgressDialog* progress);
-    QDateTime constructDateTimeForDayReport(int row, int col);
-    QDateTime constructDateTimeForMonthReport(int row, int col);
+    void enterRefreshStage(RefreshStage stage, const QString& label);
+    void runRefreshRescanStage();
+    void runRefreshFetchStage(bool startQuery);
+    void runRefreshFillStage();
+    void applyFillResults();
+    void runRefreshRecalcStage();
+    void runRefreshFormatStage();
+    void finishTemplateRefresh(bool success, bool canceled);
+    void disconnectRefreshConnections();
+
+    // ===== 区域聚合索引维护 =====
+    CellValue aggregateInputValue(int row, int col) const;  // 索引中的单元格数值（待计算的公式记为空）
+    void updateAggregateCell(int row, int col);             // 单元格写入后更新索引
 
     // ===== 模式分发函数 =====
     QVariant getTemplateCellData(const QModelIndex& index, int role) const;
     QVariant getUnifiedQueryCellData(const QModelIndex& index, int role) const;  // 修改：实现
 
-    bool refreshTemplateReport(QProgressDialog* progress);
-
     // ===== 统一查询辅助函数 =====
     bool loadUnifiedQueryConfig(const QString& filePath);  // 修改：实现
     bool refreshUnifiedQuery(QProgressDialog* progress);   // 修改：实现
+    void syncUnifiedResult();                              // 从解析器取回最新发布的快照（部分快照按新定稿的行追加）
 
     bool loadFromExcelFile(const QString& fileName);
 
@@ -220,10 +284,9 @@ private:
     QSet<QPoint> getCurrentFormulas() const;
     QList<QString> getNewBindings() const;
 
-    // ===== 公式依赖检查 =====
-    bool checkFormulaDependenciesReady(int row, int col);
-    QPoint parseCellReference(const QString& cellRef) const;
-    bool detectCircularDependency(int row, int col, QSet<QPoint>& visitedCells);
+    // ===== 公式依赖 =====
+    void updateFormulaGraph(const QPoint& pos, const CellData* cell);  // 按单元格当前公式更新依赖图
+    void rebuildFormulaGraph();                                         // 按全部公式单元格重建依赖图（行列移位后）
 
     Qt::ItemFlags getTemplateModeFlags(const QModelIndex& index) const;
     Qt::ItemFlags getUnifiedQueryModeFlags(const QModelIndex& index) const;